@@ -24,6 +24,7 @@
 
 #include <limits>
 #include <memory>
+#include <vector>
 #include "lima/HwBufferMgr.h"
 #include "lima/HwMaxImageSizeCallback.h"
 
@@ -45,7 +46,8 @@ DEB_CLASS_NAMESPC(DebModCamera, "Camera", "Hexitec");
 
 	friend class Interface;
 public:
-	Camera(const std::string& ipAddress, const std::string& configFilename, int bufferCount=50, int timeout=6000, int asicPitch=250);
+	Camera(const std::string& ipAddress, const std::string& configFilename, int bufferCount=50, int timeout=6000, int asicPitch=250,
+			const std::string& configStateFilename="");
 	~Camera();
 
 	enum Status { Ready, Initialising, Exposure, Readout, Paused, Fault };
@@ -83,6 +85,31 @@ public:
 		double ntcTemperature;
 	};
 
+	struct StreamStatistics {
+		double bandwidth;             ///< Mbit/s
+		double acquisitionRate;       ///< frames/s received by the stream
+		double frameRate;             ///< frames/s handed to Lima
+		long blockCount;
+		long blocksDropped;
+		long blockIdsMissing;
+		long resendGroupRequested;
+		long resendPacketRequested;
+		int pipelineQueueDepth;       ///< frames received but not yet retrieved
+	};
+
+	struct TelemetrySample {
+		double timestamp;             ///< seconds since the epoch, when the values were read
+		Environment env;
+		OperatingValues opval;
+	};
+
+	// detector frames are counted from the first frame of the acquisition, lost and discarded ones included
+	struct BiasRefreshWindow {
+		int startFrame;               ///< first frame discarded for the bias refresh
+		int endFrame;                 ///< first frame published again, after the settle time
+		int imageNumber;              ///< Lima frame number of that frame
+	};
+
 	// hw interface
 	void initialise();
 	void prepareAcq();
@@ -128,11 +155,34 @@ public:
 	// Hexitec specific
 	void getEnvironmentalValues(Environment& env);
 	void getOperatingValues(OperatingValues& opval);
+	void getStreamStatistics(StreamStatistics& stats);
+	void setStatisticsInterval(int millis);
+	void getStatisticsInterval(int& millis);
+	void setBufferMemoryBudget(int megabytes);
+	void getBufferMemoryBudget(int& megabytes);
+	void setStallTolerance(int millis);
+	void getStallTolerance(int& millis);
+	void getPipelineBufferCount(int& count);
+	void getLimaBufferCount(int& count);
 	void getCollectDcTimeout(int& timeout);
 	void setCollectDcTimeout(int timeout);
     void getFrameTimeout(int& timeout);
     void setFrameTimeout(int timeout);
 	void collectOffsetValues();
+	void resyncRegisters();
+	void setRegisterCoherenceCheck(bool enable);
+	void getRegisterCoherenceCheck(bool& enable);
+	void setTelemetryDeadline(int deadline);
+	void getTelemetryDeadline(int& deadline);
+	void setTelemetryInterval(int millis);
+	void getTelemetryInterval(int& millis);
+	void getTelemetrySample(int age, TelemetrySample& sample);
+	void getTelemetryHistory(double seconds, std::vector<TelemetrySample>& samples);
+	void setTelemetryFile(const std::string& filename);
+	void getTelemetryFile(std::string& filename);
+	void getSerialStatistics(std::string& report);
+	void resetSerialStatistics();
+	void getInitialiseReport(std::string& report);
 	void setType(ProcessType type);
 	void getType(ProcessType& type);
 	void setBinWidth(int binWidth);
@@ -143,6 +193,12 @@ public:
 	void getLowThreshold(int& threshold);
 	void setHighThreshold(int threshold);
 	void getHighThreshold(int& threshold);
+	void setEventThreshold(int threshold);
+	void getEventThreshold(int& threshold);
+	void setEventMaxEnergy(int energy);
+	void getEventMaxEnergy(int& energy);
+	void setChargeSharingKernel(int size);
+	void getChargeSharingKernel(int& size);
 	void getFrameRate(double& rate);
 	void setHvBiasOn();
 	void setHvBiasOff();
@@ -161,15 +217,52 @@ public:
 	void setFramesPerTrigger(int nframes);
 	void getFramesPerTrigger(int& nframes);
 	void getSkippedFrameCount(int& count);
+	void getMissingFrameCount(int& count);
+	void getDiscardedFrameCount(int& count);
+	void getBiasRefreshCount(int& count);
+	void getBiasRefreshWindow(int index, BiasRefreshWindow& window);
+	void setZeroCopy(bool enable);
+	void getZeroCopy(bool& enable);
+	void setTransferBufferFrameCount(int nframes);
+	void getTransferBufferFrameCount(int& nframes);
+	void setAcqThreadCpus(const std::string& cpus);
+	void getAcqThreadCpus(std::string& cpus);
+	void setAcqThreadPriority(int priority);
+	void getAcqThreadPriority(int& priority);
+	void setBufferHandlingThreadCpus(const std::string& cpus);
+	void getBufferHandlingThreadCpus(std::string& cpus);
+	void setBufferHandlingThreadPriority(int priority);
+	void getBufferHandlingThreadPriority(int& priority);
+	void setHugePages(bool enable);
+	void getHugePages(bool& enable);
+	void setLockBuffers(bool enable);
+	void getLockBuffers(bool& enable);
+	void setNumaBinding(bool enable);
+	void getNumaBinding(bool& enable);
+	void getBufferAllocation(std::string& allocation);
+	void setPreArm(bool enable);
+	void getPreArm(bool& enable);
+	void getStartLatency(double& millis);
+	void setBiasSettleTolerance(double volts);
+	void getBiasSettleTolerance(double& volts);
+	void getBiasSettleTime(double& millis);
 
 private:
 	class AcqThread;
 	class TimerThread;
+	class StatisticsThread;
+	class TelemetryThread;
 	class TaskEventCb;
+	class TransferBufferCb;
 
 	struct Private;
 	std::shared_ptr<Private> m_private;
 
+	void computeBufferDepths(const FrameDim& frame_dim, int& pipeline_buffers, int& lima_buffers);
+	bool getRecentTelemetry(TelemetrySample& sample);
+	void waitForBiasSettle();
+	void writeTelemetryRecord(const TelemetrySample& sample, int frame);
+
 	// Buffer control object
 	SoftBufferCtrlObj* m_bufferCtrlObj;
 	// Saving control object
@@ -190,6 +283,7 @@ private:
 	int m_offset_y;
 	std::string m_ipAddress;
 	std::string m_configFilename;
+	std::string m_configStateFilename;
 	int m_bufferCount;
 	int m_timeout;
 	double m_exp_time;
@@ -206,12 +300,35 @@ private:
 	int m_speclen;
 	int m_lowThreshold;
 	int m_highThreshold;
+	int m_eventThreshold;
+	int m_eventMaxEnergy;
+	int m_chargeSharingKernel;
 	int m_saved_frame_nb;
 	int m_biasVoltageRefreshInterval;
 	int m_biasVoltageRefreshTime;
 	int m_biasVoltageSettleTime;
 	int m_saveOpt;
 	int m_errCount;
+	bool m_zeroCopy;
+	int m_transferBufferFrameCount;
+	std::string m_acqThreadCpus;
+	int m_acqThreadPriority;
+	std::string m_bufferHandlingThreadCpus;
+	int m_missingFrameCount;
+	int m_discardedFrameCount;
+	int m_statisticsInterval;
+	int m_bufferMemoryBudget;
+	int m_stallTolerance;
+	bool m_hugePages;
+	bool m_lockBuffers;
+	bool m_numaBinding;
+	bool m_preArm;
+	double m_startLatency;
+	double m_biasSettleTolerance;
+	double m_biasSettleTime;
+	bool m_registerCoherenceCheck;
+	int m_telemetryDeadline;
+	int m_telemetryInterval;
 };
 } // namespace Hexitec
 } // namespace lima
@@ -0,0 +1,352 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITEC_CHARGE_SHARING_H
+#define HEXITEC_CHARGE_SHARING_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+
+namespace lima {
+namespace Hexitec {
+
+/**
+ * Charge sharing addition on a sorted frame. A photon whose charge spreads over
+ * neighbouring pixels shows up as a group of hits, pixels above the event threshold.
+ * Hits closer than the kernel radius (1 for 3x3, 2 for 5x5) belong to the same
+ * cluster, transitively; kernels of 3 and 5 are supported. The energy of a cluster
+ * of two or more hits is summed into its largest pixel and the other hits are
+ * cleared; a sum reaching the maximum energy is taken for pile up and the cluster is
+ * left as it is. Pixels at or below the threshold are never changed.
+ *
+ * The frame is turned into one bit per pixel, 16 pixels per compare where SSE2 exists,
+ * and the neighbourhoods are worked out a 64 bit word at a time: isolated hits and
+ * rows without hits are never visited. The other hits are merged with union-find, the
+ * earlier neighbours of a hit read from the bits of the rows above and looked up in a
+ * ring of hit numbers. The sum and the largest hit of a cluster are kept on its root
+ * as clusters merge, so past the bit scan the cost follows the number of clustered
+ * hits, not the frame area. The scratch vectors and the neighbour tables are kept
+ * between frames, use one object per thread.
+ */
+class ChargeSharing {
+public:
+	ChargeSharing() : m_words(0), m_tableRadius(-1), m_hitCount(0), m_clusterCount(0) {}
+
+	// returns the number of clusters summed
+	int add(uint16_t* frame, int width, int height, int kernel, int eventThreshold, int maxEnergy) {
+		int radius = kernel / 2;
+
+		findHits(frame, width, height, eventThreshold);
+		cluster(frame, width, height, radius);
+		return sumClusters(frame, maxEnergy);
+	}
+
+	// hits with a neighbour, isolated hits are not counted
+	int hitCount() const {
+		return m_hitCount;
+	}
+
+	int clusterCount() const {
+		return m_clusterCount;
+	}
+
+private:
+	// a hit, and for a root the cluster it stands for
+	struct Hit {
+		int index;                    ///< frame offset
+		int parent;
+		uint32_t sum;
+		uint64_t largest;             ///< key() of the largest hit, the first in raster order on a tie
+	};
+
+	// orders hits by value, then by reverse frame offset
+	static uint64_t key(uint16_t value, int index) {
+		return ((uint64_t) value << 32) | (0xffffffffu - (uint32_t) index);
+	}
+
+	// column c of a row is bit c + 64 of its words: a zero word on each side lets the
+	// neighbourhood of any column be read without bounds checks. The padding is only
+	// cleared when the frame size changes, the other words are rewritten every frame
+	void findHits(const uint16_t* frame, int width, int height, int eventThreshold) {
+		uint16_t threshold = (uint16_t) std::max(0, std::min(eventThreshold, 0xffff));
+		int words = (width + 63) / 64 + 2;
+
+		if (words != m_words || (int) m_mask.size() != words * height) {
+			m_words = words;
+			m_mask.assign(words * height, 0);
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		const __m128i limit = _mm_set1_epi16((short) threshold);
+		const __m128i zero = _mm_setzero_si128();
+#endif
+		for (int i = 0; i < height; i++) {
+			const uint16_t* row = frame + i * width;
+			uint64_t* mask = &m_mask[i * words + 1];
+
+			for (int j = 0; j < width; j += 64) {
+				int end = std::min(width, j + 64);
+				uint64_t bits = 0;
+				int k = j;
+
+#if defined(__x86_64__) || defined(__i386__)
+				if (end - j == 64) {
+					bits = above16(row + j, limit, zero) | ((uint64_t) above16(row + j + 16, limit, zero) << 16)
+							| ((uint64_t) above16(row + j + 32, limit, zero) << 32)
+							| ((uint64_t) above16(row + j + 48, limit, zero) << 48);
+					k = end;
+				}
+				for (; k + 16 <= end; k += 16) {
+					bits |= (uint64_t) above16(row + k, limit, zero) << (k - j);
+				}
+#endif
+				for (; k < end; k++) {
+					bits |= (uint64_t) (row[k] > threshold) << (k - j);
+				}
+				mask[j / 64] = bits;
+			}
+		}
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	// one bit for each of 16 pixels: above the threshold, they leave a non zero
+	// saturated difference
+	static uint32_t above16(const uint16_t* pixels, __m128i limit, __m128i zero) {
+		__m128i low = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_loadu_si128((const __m128i*) pixels), limit), zero);
+		__m128i high = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_loadu_si128((const __m128i*) (pixels + 8)), limit), zero);
+		return ~_mm_movemask_epi8(_mm_packs_epi16(low, high)) & 0xffff;
+	}
+#endif
+
+	// count bits of a row from column first on, first may be negative
+	static uint64_t window(const uint64_t* mask, int first, int count) {
+		unsigned bit = first + 64;
+		const uint64_t* word = mask + bit / 64;
+		uint64_t bits = (word[0] >> (bit % 64)) | ((word[1] << 1) << (63 - bit % 64));
+		return bits & ((1ULL << count) - 1);
+	}
+
+	// the bits within radius columns of a set bit of word[0], the bit itself excluded;
+	// word[-1] and word[1] are the words next to it
+	static uint64_t spread(const uint64_t* word, int radius) {
+		uint64_t bits = 0;
+		for (int k = 1; k <= radius; k++) {
+			bits |= (word[0] << k) | (word[-1] >> (64 - k)) | (word[0] >> k) | (word[1] << (64 - k));
+		}
+		return bits;
+	}
+
+	// the neighbour bits of a hit: radius to its left, then 2 * radius + 1 per row above.
+	// Neighbours within radius of each other are in one cluster already, merging with one
+	// of them is enough. Only built when the kernel changes
+	void neighbourTables(int radius) {
+		if (radius == m_tableRadius) {
+			return;
+		}
+		for (int k = 0; k < radius; k++) {
+			m_lineOf[k] = 0;
+			m_columnOf[k] = k - radius;
+		}
+		for (int k = 0; k < radius * (2 * radius + 1); k++) {
+			m_lineOf[radius + k] = 1 + k / (2 * radius + 1);
+			m_columnOf[radius + k] = k % (2 * radius + 1) - radius;
+		}
+		for (int k = 0; k < radius * (2 * radius + 2); k++) {
+			m_joined[k] = 0;
+			for (int l = 0; l < radius * (2 * radius + 2); l++) {
+				if (std::abs(m_lineOf[k] - m_lineOf[l]) <= radius && std::abs(m_columnOf[k] - m_columnOf[l]) <= radius) {
+					m_joined[k] |= 1ULL << l;
+				}
+			}
+		}
+		m_tableRadius = radius;
+	}
+
+	// the hits are visited a row at a time, rows without any are skipped. A hit with no
+	// other hit within radius rows and columns is never touched. The others get a number
+	// and are merged with the earlier hits next to them, found by number in a ring of
+	// radius+1 rows; the hits with no earlier neighbour are numbered first, as they only
+	// start a cluster. Only positions of such hits are ever read, so the ring is never
+	// cleared
+	void cluster(const uint16_t* frame, int width, int height, int radius) {
+		int rows = radius + 1;
+		int words = m_words;
+		int count = 0;
+		int* lines[3];                // hit numbers of this row and the radius rows above
+
+		neighbourTables(radius);
+		if ((int) m_label.size() < rows * width) {
+			m_label.resize(rows * width);
+		}
+		m_linked.resize(words);
+		for (int i = 0, line = 0; i < height; i++, line = (line + 1 < rows) ? line + 1 : 0) {
+			const uint64_t* mask = &m_mask[i * words];
+			uint64_t any = 0;
+
+			for (int w = 1; w < words - 1; w++) {
+				any |= mask[w];
+			}
+			if (!any) {
+				continue;
+			}
+			for (int dy = 0; dy <= radius; dy++) {
+				lines[dy] = &m_label[(line - dy + ((line < dy) ? rows : 0)) * width];
+			}
+			// room for a full row, so the loops below can work through a plain pointer
+			if ((int) m_hit.size() < count + width) {
+				m_hit.resize(std::max<size_t>(count + width, 2 * m_hit.size()));
+			}
+			Hit* hits = m_hit.data();
+			for (int w = 1; w < words - 1; w++) {
+				uint64_t above[3] = {0, 0, 0};
+				uint64_t below[3] = {0, 0, 0};
+				uint64_t left = 0;
+
+				m_linked[w] = 0;
+				if (!mask[w]) {
+					continue;
+				}
+				for (int dy = 1; dy <= radius; dy++) {
+					if (dy <= i) {
+						const uint64_t* row = mask - dy * words + w;
+						above[0] |= row[-1];
+						above[1] |= row[0];
+						above[2] |= row[1];
+					}
+					if (i + dy < height) {
+						const uint64_t* row = mask + dy * words + w;
+						below[0] |= row[-1];
+						below[1] |= row[0];
+						below[2] |= row[1];
+					}
+				}
+				for (int k = 1; k <= radius; k++) {
+					left |= (mask[w] << k) | (mask[w - 1] >> (64 - k));
+				}
+				uint64_t linked = mask[w] & (above[1] | spread(above + 1, radius) | left);
+				uint64_t first = mask[w] & ~linked & (below[1] | spread(below + 1, radius) | spread(mask + w, radius));
+
+				for (uint64_t bits = first; bits; bits &= bits - 1) {
+					int column = (w - 1) * 64 + __builtin_ctzll(bits);
+					int h = count++;
+
+					newHit(hits[h], h, frame, i * width + column);
+					lines[0][column] = h;
+				}
+				m_linked[w] = linked;
+			}
+			for (int w = 1; w < words - 1; w++) {
+				for (uint64_t bits = m_linked[w]; bits; bits &= bits - 1) {
+					int column = (w - 1) * 64 + __builtin_ctzll(bits);
+					int h = count++;
+					int root = h;
+					uint64_t neighbours = window(mask, column - radius, radius);
+
+					newHit(hits[h], h, frame, i * width + column);
+					for (int dy = 1; dy <= radius && dy <= i; dy++) {
+						neighbours |= window(mask - dy * words, column - radius, 2 * radius + 1)
+								<< (radius + (dy - 1) * (2 * radius + 1));
+					}
+					while (neighbours) {
+						int k = __builtin_ctzll(neighbours);
+						root = merge(hits, root, lines[m_lineOf[k]][column + m_columnOf[k]]);
+						neighbours &= ~m_joined[k];
+					}
+					lines[0][column] = h;
+				}
+			}
+		}
+		m_hitCount = count;
+	}
+
+	static void newHit(Hit& hit, int h, const uint16_t* frame, int index) {
+		hit.index = index;
+		hit.parent = h;
+		hit.sum = frame[index];
+		hit.largest = key(frame[index], index);
+	}
+
+	static int find(Hit* hits, int h) {
+		while (hits[h].parent != h) {
+			hits[h].parent = hits[hits[h].parent].parent;
+			h = hits[h].parent;
+		}
+		return h;
+	}
+
+	// folds the cluster of hit h and the one of root together, the earlier root stays;
+	// returns it
+	static int merge(Hit* hits, int root, int h) {
+		h = find(hits, h);
+		if (h == root) {
+			return root;
+		}
+		Hit& keep = hits[std::min(h, root)];
+		Hit& other = hits[std::max(h, root)];
+		other.parent = std::min(h, root);
+		keep.sum += other.sum;
+		keep.largest = std::max(keep.largest, other.largest);
+		return other.parent;
+	}
+
+	// every hit kept has a neighbour, so each belongs to a cluster of two or more. A
+	// parent always comes before its children, so in hit order the parent already
+	// points at the root
+	int sumClusters(uint16_t* frame, int maxEnergy) {
+		Hit* hits = m_hit.data();
+
+		m_clusterCount = 0;
+		for (int h = 0; h < m_hitCount; h++) {
+			Hit& hit = hits[h];
+			hit.parent = hits[hit.parent].parent;
+			const Hit& root = hits[hit.parent];
+			// masks rather than branches, piled up and summed clusters come in any order
+			uint32_t summed = 0u - (uint32_t) (root.sum < (uint32_t) maxEnergy);
+			uint32_t largest = 0u - (uint32_t) ((uint32_t) hit.index == 0xffffffffu - (uint32_t) root.largest);
+			uint32_t value = largest & std::min<uint32_t>(root.sum, 0xffff);
+
+			frame[hit.index] = (uint16_t) ((value & summed) | (frame[hit.index] & ~summed));
+			m_clusterCount += summed & largest & 1;
+		}
+		return m_clusterCount;
+	}
+
+	std::vector<uint64_t> m_mask;     ///< hit bits, m_words per row
+	std::vector<uint64_t> m_linked;   ///< hits of the current row with an earlier neighbour
+	std::vector<int> m_label;         ///< hit number by column for the last radius+1 rows
+	std::vector<Hit> m_hit;
+	int m_words;
+	int m_tableRadius;                ///< radius the neighbour tables below are built for
+	int m_lineOf[32];                 ///< row above, 0 for the current one, of neighbour bit k
+	int m_columnOf[32];               ///< column of neighbour bit k relative to the hit
+	uint64_t m_joined[32];            ///< neighbour bits within radius of neighbour bit k
+	int m_hitCount;
+	int m_clusterCount;
+};
+
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITEC_CHARGE_SHARING_H
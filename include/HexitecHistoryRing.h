@@ -0,0 +1,135 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2017
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITEC_HISTORY_RING_H
+#define HEXITEC_HISTORY_RING_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace lima {
+namespace Hexitec {
+
+/*******************************************************************
+ * \class HistoryRing
+ * \brief fixed size history written by one thread, read by any number
+ *
+ * The writer never waits. Every slot carries a sequence number, readers
+ * retry while the slot is being written and skip samples that were
+ * overwritten while they copied them. T must be trivially copyable.
+ *******************************************************************/
+template <typename T>
+class HistoryRing {
+public:
+	explicit HistoryRing(size_t capacity) : m_slots(capacity ? capacity : 1), m_count(0) {
+		for (auto& slot : m_slots) {
+			slot.sequence.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	size_t capacity() const {
+		return m_slots.size();
+	}
+
+	// only from the writing thread
+	void push(const T& value) {
+		uint64_t index = m_count.load(std::memory_order_relaxed);
+		Slot& slot = m_slots[index % m_slots.size()];
+		uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+		slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.value = value;
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+		m_count.store(index + 1, std::memory_order_release);
+	}
+
+	// total number of samples pushed so far
+	uint64_t count() const {
+		return m_count.load(std::memory_order_acquire);
+	}
+
+	bool latest(T& value) const {
+		while (true) {
+			uint64_t count = m_count.load(std::memory_order_acquire);
+			if (count == 0) {
+				return false;
+			}
+			if (read(count - 1, value)) {
+				return true;
+			}
+		}
+	}
+
+	// up to maxCount most recent samples, oldest first
+	size_t history(std::vector<T>& values, size_t maxCount) const {
+		uint64_t count = m_count.load(std::memory_order_acquire);
+		uint64_t length = std::min<uint64_t>(std::min<uint64_t>(count, m_slots.size()), maxCount);
+		T value;
+
+		values.clear();
+		values.reserve(length);
+		for (uint64_t index = count - length; index < count; index++) {
+			if (read(index, value)) {
+				values.push_back(value);
+			}
+		}
+		return values.size();
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence;	///< odd while written, 2 * generation when holding a sample
+		T value;
+	};
+
+	// false once the sample at index has been overwritten
+	bool read(uint64_t index, T& value) const {
+		const Slot& slot = m_slots[index % m_slots.size()];
+		uint64_t expected = 2 * (index / m_slots.size() + 1);
+
+		while (true) {
+			uint64_t before = slot.sequence.load(std::memory_order_acquire);
+			if (before > expected) {
+				return false;
+			}
+			if (before != expected) {
+				continue;
+			}
+			value = slot.value;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == before) {
+				return true;
+			}
+		}
+	}
+
+	std::vector<Slot> m_slots;
+	std::atomic<uint64_t> m_count;
+};
+
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITEC_HISTORY_RING_H
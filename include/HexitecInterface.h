@@ -31,6 +31,7 @@ namespace Hexitec {
 class Camera;
 class DetInfoCtrlObj;
 class SyncCtrlObj;
+class ReconstructionCtrlObj;
 
 /*******************************************************************
  * \class Interface
@@ -62,6 +63,7 @@ private:
 	CapList m_cap_list;
 	DetInfoCtrlObj *m_det_info;
 	SyncCtrlObj *m_sync;
+	ReconstructionCtrlObj *m_reconstruction;
 
 };
 } // namespace Hexitec
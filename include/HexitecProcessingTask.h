@@ -0,0 +1,71 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITECPROCESSINGTASK_H
+#define HEXITECPROCESSINGTASK_H
+
+#include "processlib/LinkTask.h"
+#include "HexitecCamera.h"
+#include "HexitecSortKernel.h"
+#include "HexitecChargeSharing.h"
+
+namespace lima
+{
+namespace Hexitec
+{
+
+/*******************************************************************
+ * \class ProcessingTask
+ * \brief Hexitec frame processing run by processlib on the Data path
+ *
+ * SORT de-interleaves the ASIC readout order into geometric order,
+ * CSA sorts and then sums the charge shared between neighbouring
+ * pixels, RAW passes the frames on unchanged. Frames are processed in place
+ * when the task manager allows it, otherwise into a new buffer.
+ *******************************************************************/
+class ProcessingTask: public LinkTask {
+DEB_CLASS_NAMESPC(DebModCamera, "ProcessingTask", "Hexitec");
+
+public:
+	ProcessingTask(Camera::ProcessType processType, int kernel, int eventThreshold, int maxEnergy);
+
+	virtual ~ProcessingTask();
+
+	virtual Data process(Data& srcData);
+
+	Camera::ProcessType getType() const {
+		return m_processType;
+	}
+
+private:
+	Data sort(Data& srcData);
+	Data chargeSharingAddition(Data& srcData);
+
+	Camera::ProcessType m_processType;
+	int m_kernel;
+	int m_eventThreshold;
+	int m_maxEnergy;
+	SortRowFunction m_sortRow;
+};
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITECPROCESSINGTASK_H
@@ -0,0 +1,58 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITECRECONSTRUCTIONCTRLOBJ_H
+#define HEXITECRECONSTRUCTIONCTRLOBJ_H
+
+#include "lima/HwReconstructionCtrlObj.h"
+
+namespace lima
+{
+namespace Hexitec
+{
+class Camera;
+class ProcessingTask;
+
+/*******************************************************************
+ * \class ReconstructionCtrlObj
+ * \brief Control object inserting the Hexitec processing task in
+ *        front of the Lima software operations
+ *******************************************************************/
+class ReconstructionCtrlObj: public HwReconstructionCtrlObj {
+DEB_CLASS_NAMESPC(DebModCamera, "ReconstructionCtrlObj", "Hexitec");
+
+public:
+	ReconstructionCtrlObj(Camera& cam);
+
+	virtual ~ReconstructionCtrlObj();
+
+	virtual LinkTask* getReconstructionTask();
+
+	void prepareAcq();
+
+private:
+	Camera& m_cam;
+	ProcessingTask* m_task;
+};
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITECRECONSTRUCTIONCTRLOBJ_H
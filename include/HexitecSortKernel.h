@@ -0,0 +1,163 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2017
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITEC_SORT_KERNEL_H
+#define HEXITEC_SORT_KERNEL_H
+
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEXITEC_SORT_X86
+#endif
+
+namespace lima {
+namespace Hexitec {
+
+/**
+ * Pixel de-interleave (SORT). The ASIC reads a row out through 4 channels, one per
+ * column block of width/4 (the 0x83 register counts these groups of four), and the
+ * stream carries one pixel of each block in turn: readout position 4*k+b holds column
+ * b*(width/4)+k. Per row this is a 4 x width/4 transpose of 16 bit values.
+ *
+ * The SIMD versions transpose 8 (SSE2) or 16 (AVX2) groups of four per step with
+ * unpack instructions and finish the row with the scalar loop. width must be a
+ * multiple of 4 and the source and destination rows must not overlap.
+ */
+typedef void (*SortRowFunction)(const uint16_t* src, uint16_t* dst, int width);
+
+// the row from group first onwards
+inline void sortRowScalarFrom(const uint16_t* src, uint16_t* dst, int width, int first) {
+	int quarter = width / 4;
+
+	src += 4 * first;
+	for (int k = first; k < quarter; k++, src += 4) {
+		dst[k] = src[0];
+		dst[quarter + k] = src[1];
+		dst[2 * quarter + k] = src[2];
+		dst[3 * quarter + k] = src[3];
+	}
+}
+
+inline void sortRowScalar(const uint16_t* src, uint16_t* dst, int width) {
+	sortRowScalarFrom(src, dst, width, 0);
+}
+
+#ifdef HEXITEC_SORT_X86
+inline void sortRowSse2From(const uint16_t* row, uint16_t* dst, int width, int first) {
+	int quarter = width / 4;
+	int k = first;
+	const uint16_t* src = row + 4 * k;
+
+	for (; k + 8 <= quarter; k += 8, src += 32) {
+		// groups a..h, a0 a1 a2 a3 b0 b1 b2 b3 | c.. d.. | e.. f.. | g.. h..
+		__m128i r0 = _mm_loadu_si128((const __m128i*) src);
+		__m128i r1 = _mm_loadu_si128((const __m128i*) (src + 8));
+		__m128i r2 = _mm_loadu_si128((const __m128i*) (src + 16));
+		__m128i r3 = _mm_loadu_si128((const __m128i*) (src + 24));
+		// a0 c0 a1 c1 a2 c2 a3 c3 | b0 d0 .. | e0 g0 .. | f0 h0 ..
+		__m128i t0 = _mm_unpacklo_epi16(r0, r1);
+		__m128i t1 = _mm_unpackhi_epi16(r0, r1);
+		__m128i t2 = _mm_unpacklo_epi16(r2, r3);
+		__m128i t3 = _mm_unpackhi_epi16(r2, r3);
+		// a0 b0 c0 d0 a1 b1 c1 d1 | a2 .. d3 | e0 .. h1 | e2 .. h3
+		__m128i u0 = _mm_unpacklo_epi16(t0, t1);
+		__m128i u1 = _mm_unpackhi_epi16(t0, t1);
+		__m128i u2 = _mm_unpacklo_epi16(t2, t3);
+		__m128i u3 = _mm_unpackhi_epi16(t2, t3);
+		_mm_storeu_si128((__m128i*) (dst + k), _mm_unpacklo_epi64(u0, u2));
+		_mm_storeu_si128((__m128i*) (dst + quarter + k), _mm_unpackhi_epi64(u0, u2));
+		_mm_storeu_si128((__m128i*) (dst + 2 * quarter + k), _mm_unpacklo_epi64(u1, u3));
+		_mm_storeu_si128((__m128i*) (dst + 3 * quarter + k), _mm_unpackhi_epi64(u1, u3));
+	}
+	sortRowScalarFrom(row, dst, width, k);
+}
+
+inline void sortRowSse2(const uint16_t* src, uint16_t* dst, int width) {
+	sortRowSse2From(src, dst, width, 0);
+}
+
+// the unpacks work within 128 bit lanes, so lane 1 is loaded with the groups 8 to 15
+__attribute__((target("avx2")))
+inline void sortRowAvx2(const uint16_t* row, uint16_t* dst, int width) {
+	int quarter = width / 4;
+	int k = 0;
+	const uint16_t* src = row;
+
+	for (; k + 16 <= quarter; k += 16, src += 64) {
+		__m256i r0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) src)),
+				_mm_loadu_si128((const __m128i*) (src + 32)), 1);
+		__m256i r1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + 8))),
+				_mm_loadu_si128((const __m128i*) (src + 40)), 1);
+		__m256i r2 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + 16))),
+				_mm_loadu_si128((const __m128i*) (src + 48)), 1);
+		__m256i r3 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + 24))),
+				_mm_loadu_si128((const __m128i*) (src + 56)), 1);
+		__m256i t0 = _mm256_unpacklo_epi16(r0, r1);
+		__m256i t1 = _mm256_unpackhi_epi16(r0, r1);
+		__m256i t2 = _mm256_unpacklo_epi16(r2, r3);
+		__m256i t3 = _mm256_unpackhi_epi16(r2, r3);
+		__m256i u0 = _mm256_unpacklo_epi16(t0, t1);
+		__m256i u1 = _mm256_unpackhi_epi16(t0, t1);
+		__m256i u2 = _mm256_unpacklo_epi16(t2, t3);
+		__m256i u3 = _mm256_unpackhi_epi16(t2, t3);
+		_mm256_storeu_si256((__m256i*) (dst + k), _mm256_unpacklo_epi64(u0, u2));
+		_mm256_storeu_si256((__m256i*) (dst + quarter + k), _mm256_unpackhi_epi64(u0, u2));
+		_mm256_storeu_si256((__m256i*) (dst + 2 * quarter + k), _mm256_unpacklo_epi64(u1, u3));
+		_mm256_storeu_si256((__m256i*) (dst + 3 * quarter + k), _mm256_unpackhi_epi64(u1, u3));
+	}
+	sortRowSse2From(row, dst, width, k);
+}
+#endif
+
+// the fastest version the cpu supports
+inline SortRowFunction selectSortRow() {
+#ifdef HEXITEC_SORT_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return sortRowAvx2;
+	}
+	return sortRowSse2;
+#else
+	return sortRowScalar;
+#endif
+}
+
+inline const char* sortRowName(SortRowFunction function) {
+#ifdef HEXITEC_SORT_X86
+	if (function == sortRowAvx2) {
+		return "avx2";
+	}
+	if (function == sortRowSse2) {
+		return "sse2";
+	}
+#endif
+	return "scalar";
+}
+
+inline void sortFrame(SortRowFunction sortRow, const uint16_t* src, uint16_t* dst, int width, int height) {
+	for (int i = 0; i < height; i++, src += width, dst += width) {
+		sortRow(src, dst, width);
+	}
+}
+
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITEC_SORT_KERNEL_H
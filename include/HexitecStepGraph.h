@@ -0,0 +1,145 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2017
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+#ifndef HEXITEC_STEP_GRAPH_H
+#define HEXITEC_STEP_GRAPH_H
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lima {
+namespace Hexitec {
+
+/*******************************************************************
+ * \class StepGraph
+ * \brief runs named steps as soon as the steps they depend on are done
+ *
+ * Each step runs on its own thread. A step can only depend on steps
+ * added before it, so the graph has no cycles. A step whose dependency
+ * failed does not run and fails with the same exception. run() waits for
+ * all steps and rethrows the first failure in the order of add().
+ *******************************************************************/
+class StepGraph {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Timing {
+		std::string name;
+		double start;		///< ms from the start of run()
+		double duration;	///< ms, 0 if the step did not complete
+		bool done;
+	};
+
+	// returns the id to name the step in later dependency lists
+	size_t add(const std::string& name, std::function<void()> body, const std::vector<size_t>& dependencies = {}) {
+		Step step;
+		step.body = body;
+		for (auto dependency : dependencies) {
+			if (dependency < m_steps.size()) {
+				step.dependencies.push_back(dependency);
+			}
+		}
+		m_steps.push_back(step);
+		m_timings.push_back(Timing{name, 0., 0., false});
+		return m_steps.size() - 1;
+	}
+
+	void run() {
+		Clock::time_point origin = Clock::now();
+		std::vector<std::shared_future<void>> futures;
+		std::exception_ptr failure;
+
+		for (size_t id = 0; id < m_steps.size(); id++) {
+			std::vector<std::shared_future<void>> dependencies;
+			for (auto dependency : m_steps[id].dependencies) {
+				dependencies.push_back(futures[dependency]);
+			}
+			futures.push_back(std::async(std::launch::async, [this, id, dependencies, origin] {
+				for (auto& dependency : dependencies) {
+					dependency.get();
+				}
+				Clock::time_point start = Clock::now();
+				m_timings[id].start = milliseconds(origin, start);
+				m_steps[id].body();
+				m_timings[id].duration = milliseconds(start, Clock::now());
+				m_timings[id].done = true;
+			}).share());
+		}
+		for (auto& future : futures) {
+			try {
+				future.get();
+			} catch (...) {
+				if (!failure) {
+					failure = std::current_exception();
+				}
+			}
+		}
+		m_elapsed = milliseconds(origin, Clock::now());
+		if (failure) {
+			std::rethrow_exception(failure);
+		}
+	}
+
+	const std::vector<Timing>& timings() const {
+		return m_timings;
+	}
+
+	// one line per step with start and duration, then the wall time of run()
+	std::string report() const {
+		std::ostringstream os;
+		os << std::fixed << std::setprecision(1);
+		for (auto& timing : m_timings) {
+			os << std::left << std::setw(24) << timing.name << std::right;
+			if (timing.done) {
+				os << " start " << std::setw(9) << timing.start << " ms  took " << std::setw(9) << timing.duration << " ms\n";
+			} else {
+				os << " not completed\n";
+			}
+		}
+		os << std::left << std::setw(24) << "total" << std::right << std::string(26, ' ') << std::setw(9) << m_elapsed << " ms\n";
+		return os.str();
+	}
+
+private:
+	struct Step {
+		std::function<void()> body;
+		std::vector<size_t> dependencies;
+	};
+
+	static double milliseconds(Clock::time_point from, Clock::time_point to) {
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	}
+
+	std::vector<Step> m_steps;
+	std::vector<Timing> m_timings;
+	double m_elapsed = 0.;
+};
+
+} // namespace Hexitec
+} // namespace lima
+
+#endif // HEXITEC_STEP_GRAPH_H
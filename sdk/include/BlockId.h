@@ -0,0 +1,53 @@
+// Gap between consecutive GigE Vision block IDs, shared by the Pleora device and
+// the dummy build which does not see the Pleora headers.
+#ifndef BLOCK_ID_H
+#define BLOCK_ID_H
+
+#include <cstdint>
+
+#define BLOCK_ID_16_BIT_MAX			0xFFFF
+#define BLOCK_ID_WRAP_WINDOW		0x100
+
+namespace GigE
+{
+/**
+ * True when Current follows Previous across the wrap of 16 bit block IDs, which
+ * count 1 to 0xFFFF and continue at 1. Only a step from the top of the range to
+ * the bottom of it counts as a wrap.
+ */
+inline bool BlockIdWrapped( uint64_t Previous, uint64_t Current )
+{
+	return ( Previous <= BLOCK_ID_16_BIT_MAX ) && ( Previous > BLOCK_ID_16_BIT_MAX - BLOCK_ID_WRAP_WINDOW )
+		&& ( Current > 0 ) && ( Current < BLOCK_ID_WRAP_WINDOW );
+}
+
+/**
+ * True when the block IDs stepped backwards without wrapping: a reordered block or
+ * a device that restarted its count. The stream resynchronises on Current.
+ */
+inline bool BlockIdRestarted( uint64_t Previous, uint64_t Current )
+{
+	return ( Current < Previous ) && !BlockIdWrapped( Previous, Current );
+}
+
+/**
+ * Number of blocks missing between two consecutive block IDs. A repeated ID and
+ * a restart count as no gap.
+ */
+inline uint64_t BlockIdGap( uint64_t Previous, uint64_t Current )
+{
+	if( Current > Previous )
+	{
+		return Current - Previous - 1;
+	}
+
+	if( BlockIdWrapped( Previous, Current ) )
+	{
+		return BLOCK_ID_16_BIT_MAX - Previous + Current - 1;
+	}
+
+	return 0;
+}
+}
+
+#endif // BLOCK_ID_H
@@ -0,0 +1,322 @@
+// Allocation of the large frame buffers: 2 MB hugepages, page locking and binding
+// to the NUMA node of the network adapter the detector is connected to. Off Linux
+// the buffers are plain page aligned allocations and no feature is ever achieved.
+#ifndef BUFFER_ALLOCATOR_H
+#define BUFFER_ALLOCATOR_H
+
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#else
+#include <malloc.h>
+#endif
+
+#define BUFFER_ALLOCATOR_HUGEPAGE_SIZE	( (size_t)2 * 1024 * 1024 )
+#define BUFFER_ALLOCATOR_MPOL_DEFAULT	0
+#define BUFFER_ALLOCATOR_MPOL_BIND		2
+#define BUFFER_ALLOCATOR_MPOL_MF_MOVE	( 1 << 1 )
+#define BUFFER_ALLOCATOR_MAX_NODES		1024
+#define BUFFER_ALLOCATOR_PAGE_SIZE		4096
+
+namespace GigE
+{
+enum BufferAllocationFlags
+{
+	BUFFER_ALLOCATION_DEFAULT		= 0,
+	BUFFER_ALLOCATION_HUGEPAGES		= 1,	// requested: 2 MB pages; achieved: reserved hugetlb pages
+	BUFFER_ALLOCATION_LOCKED		= 2,	// pages locked in memory
+	BUFFER_ALLOCATION_NUMA			= 4,	// pages bound to cNumaNode
+	BUFFER_ALLOCATION_TRANSPARENT	= 8,	// achieved only: transparent hugepages advised instead
+};
+
+/**
+ * Allocate returns page aligned memory that is not zero-filled by the allocator; the
+ * kernel hands out zeroed pages, which are faulted in up front when locking. Requested
+ * features the system refuses (no reserved hugepages, RLIMIT_MEMLOCK, no NUMA) are
+ * dropped, GetAchieved() reports what the last call actually got and GetError() why
+ * the last Prepare or Reset missed something.
+ */
+class BufferAllocator
+{
+public:
+	BufferAllocator()
+	{
+		cFlags = BUFFER_ALLOCATION_DEFAULT;
+		cNumaNode = -1;
+		cAchieved = BUFFER_ALLOCATION_DEFAULT;
+	}
+
+	// NumaNode is ignored unless BUFFER_ALLOCATION_NUMA is set
+	void SetMode( uint32_t Flags, int NumaNode )
+	{
+		cFlags = Flags;
+		cNumaNode = NumaNode;
+	}
+
+	uint32_t GetFlags() const
+	{
+		return cFlags;
+	}
+
+	int GetNumaNode() const
+	{
+		return cNumaNode;
+	}
+
+	uint32_t GetAchieved() const
+	{
+		return cAchieved;
+	}
+
+	// the failed calls with their errno text, empty if all went through
+	const std::string &GetError() const
+	{
+		return cError;
+	}
+
+	uint8_t *Allocate( size_t Size )
+	{
+#ifdef __linux__
+		void	*lBuffer = MAP_FAILED;
+
+		cAchieved = BUFFER_ALLOCATION_DEFAULT;
+		if( cFlags & BUFFER_ALLOCATION_HUGEPAGES )
+		{
+			lBuffer = mmap( NULL, MappedSize( Size ), PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+			if( lBuffer != MAP_FAILED )
+			{
+				cAchieved |= BUFFER_ALLOCATION_HUGEPAGES;
+			}
+		}
+		if( lBuffer == MAP_FAILED )
+		{
+			lBuffer = mmap( NULL, MappedSize( Size ), PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			if( lBuffer == MAP_FAILED )
+			{
+				return NULL;
+			}
+		}
+		// before the first touch so the pages are created on the right node
+		cAchieved |= Prepare( lBuffer, Size, !( cAchieved & BUFFER_ALLOCATION_HUGEPAGES ) );
+		return (uint8_t*)lBuffer;
+#else
+		cAchieved = BUFFER_ALLOCATION_DEFAULT;
+		return (uint8_t*)_aligned_malloc( Size, BUFFER_ALLOCATOR_PAGE_SIZE );
+#endif
+	}
+
+	void Free( uint8_t *Buffer, size_t Size )
+	{
+		if( Buffer )
+		{
+#ifdef __linux__
+			munmap( Buffer, MappedSize( Size ) );
+#else
+			_aligned_free( Buffer );
+#endif
+		}
+	}
+
+	// applies the mode to memory allocated elsewhere (e.g. the Lima frame ring), where
+	// hugepages can only be advised; returns the achieved flags. Each call splits the
+	// mapping, so prepare contiguous memory in one call; transparent hugepages need
+	// at least 2 MB anyway
+	uint32_t Prepare( void *Buffer, size_t Size, bool AdviseHugePages = true )
+	{
+		uint32_t	lAchieved = BUFFER_ALLOCATION_DEFAULT;
+#ifdef __linux__
+		size_t		lPage = sysconf( _SC_PAGESIZE );
+		uintptr_t	lFirst = ( (uintptr_t)Buffer + lPage - 1 ) & ~( lPage - 1 );
+		uintptr_t	lLast = ( (uintptr_t)Buffer + Size ) & ~( lPage - 1 );
+
+		cError.clear();
+
+		if( ( cFlags & BUFFER_ALLOCATION_NUMA ) && ( cNumaNode >= 0 ) && ( cNumaNode < BUFFER_ALLOCATOR_MAX_NODES ) && ( lLast > lFirst ) )
+		{
+			unsigned long	lMask[BUFFER_ALLOCATOR_MAX_NODES / ( 8 * sizeof( unsigned long ) )];
+
+			memset( lMask, 0, sizeof( lMask ) );
+			lMask[cNumaNode / ( 8 * sizeof( unsigned long ) )] |= 1UL << ( cNumaNode % ( 8 * sizeof( unsigned long ) ) );
+			if( syscall( SYS_mbind, lFirst, lLast - lFirst, BUFFER_ALLOCATOR_MPOL_BIND, lMask,
+						 BUFFER_ALLOCATOR_MAX_NODES + 1, BUFFER_ALLOCATOR_MPOL_MF_MOVE ) == 0 )
+			{
+				lAchieved |= BUFFER_ALLOCATION_NUMA;
+			}
+			else
+			{
+				AddError( "mbind" );
+			}
+		}
+#ifdef MADV_HUGEPAGE
+		if( ( cFlags & BUFFER_ALLOCATION_HUGEPAGES ) && AdviseHugePages && ( lLast > lFirst ) )
+		{
+			if( madvise( (void*)lFirst, lLast - lFirst, MADV_HUGEPAGE ) == 0 )
+			{
+				lAchieved |= BUFFER_ALLOCATION_TRANSPARENT;
+			}
+			else
+			{
+				AddError( "madvise" );
+			}
+		}
+#endif
+		if( cFlags & BUFFER_ALLOCATION_LOCKED )
+		{
+			if( mlock( Buffer, Size ) == 0 )
+			{
+				lAchieved |= BUFFER_ALLOCATION_LOCKED;
+			}
+			else
+			{
+				AddError( "mlock" );
+			}
+		}
+#else
+		cError.clear();
+#endif
+		return lAchieved;
+	}
+
+	// undoes Prepare for the features in Flags: default memory policy, no transparent
+	// hugepages, unlocked; returns false if a call failed
+	bool Reset( void *Buffer, size_t Size, uint32_t Flags )
+	{
+#ifdef __linux__
+		size_t		lPage = sysconf( _SC_PAGESIZE );
+		uintptr_t	lFirst = ( (uintptr_t)Buffer + lPage - 1 ) & ~( lPage - 1 );
+		uintptr_t	lLast = ( (uintptr_t)Buffer + Size ) & ~( lPage - 1 );
+
+		cError.clear();
+		if( ( Flags & BUFFER_ALLOCATION_NUMA ) && ( lLast > lFirst ) )
+		{
+			if( syscall( SYS_mbind, lFirst, lLast - lFirst, BUFFER_ALLOCATOR_MPOL_DEFAULT, NULL, 0, 0 ) != 0 )
+			{
+				AddError( "mbind" );
+			}
+		}
+#ifdef MADV_NOHUGEPAGE
+		if( ( Flags & BUFFER_ALLOCATION_HUGEPAGES ) && ( lLast > lFirst ) )
+		{
+			if( madvise( (void*)lFirst, lLast - lFirst, MADV_NOHUGEPAGE ) != 0 )
+			{
+				AddError( "madvise" );
+			}
+		}
+#endif
+		if( Flags & BUFFER_ALLOCATION_LOCKED )
+		{
+			if( munlock( Buffer, Size ) != 0 )
+			{
+				AddError( "munlock" );
+			}
+		}
+#else
+		cError.clear();
+#endif
+		return cError.empty();
+	}
+
+	static std::string Describe( uint32_t Flags, int NumaNode )
+	{
+		std::string	lText;
+
+		if( Flags & BUFFER_ALLOCATION_HUGEPAGES )
+		{
+			lText += "hugepages ";
+		}
+		if( Flags & BUFFER_ALLOCATION_TRANSPARENT )
+		{
+			lText += "transparent-hugepages ";
+		}
+		if( Flags & BUFFER_ALLOCATION_LOCKED )
+		{
+			lText += "locked ";
+		}
+		if( Flags & BUFFER_ALLOCATION_NUMA )
+		{
+			lText += "numa-node-" + std::to_string( NumaNode ) + " ";
+		}
+		if( lText.empty() )
+		{
+			return "default";
+		}
+		lText.erase( lText.size() - 1 );
+		return lText;
+	}
+
+	// NUMA node of the local interface whose subnet contains IpAddress, -1 if unknown
+	static int NumaNodeOfPeer( const std::string &IpAddress )
+	{
+#ifdef __linux__
+		struct in_addr	lPeer;
+		struct ifaddrs	*lList = NULL;
+		int				lNode = -1;
+
+		if( ( inet_pton( AF_INET, IpAddress.c_str(), &lPeer ) != 1 ) || ( getifaddrs( &lList ) != 0 ) )
+		{
+			return -1;
+		}
+		for( struct ifaddrs *lIf = lList ; lIf ; lIf = lIf->ifa_next )
+		{
+			if( !lIf->ifa_addr || !lIf->ifa_netmask || ( lIf->ifa_addr->sa_family != AF_INET ) )
+			{
+				continue;
+			}
+			uint32_t lAddress = ( (struct sockaddr_in*)lIf->ifa_addr )->sin_addr.s_addr;
+			uint32_t lMask = ( (struct sockaddr_in*)lIf->ifa_netmask )->sin_addr.s_addr;
+
+			if( ( lAddress & lMask ) == ( lPeer.s_addr & lMask ) )
+			{
+				std::ifstream	lFile( std::string( "/sys/class/net/" ) + lIf->ifa_name + "/device/numa_node" );
+
+				if( !( lFile >> lNode ) )
+				{
+					lNode = -1;
+				}
+				break;
+			}
+		}
+		freeifaddrs( lList );
+		return lNode;
+#else
+		return -1;
+#endif
+	}
+
+private:
+	void AddError( const char *Call )
+	{
+		if( !cError.empty() )
+		{
+			cError += ", ";
+		}
+		cError += std::string( Call ) + ": " + strerror( errno );
+	}
+
+	// both kinds of mapping are rounded to whole hugepages so Free does not need to know
+	// which one it got; the tail of a normal mapping is never touched and costs nothing
+	static size_t MappedSize( size_t Size )
+	{
+		return ( Size + BUFFER_ALLOCATOR_HUGEPAGE_SIZE - 1 ) & ~( BUFFER_ALLOCATOR_HUGEPAGE_SIZE - 1 );
+	}
+
+	uint32_t	cFlags;
+	int			cNumaNode;
+	uint32_t	cAchieved;
+	std::string	cError;
+};
+
+} // namespace GigE
+#endif // BUFFER_ALLOCATOR_H
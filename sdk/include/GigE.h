@@ -36,12 +36,15 @@
 #include <PvDeviceSerialPort.h>
 #include <PvDeviceAdapter.h>
 #include <PvDeviceInfoGEV.h>
-#include <queue>
+#include <SpscRing.h>
+#include <BlockId.h>
+#include <BufferAllocator.h>
+#include <SerialSimulator.h>
+#include <mutex>
 
 #ifdef __linux__
 #include <aS_messages.h>
 #include <thread>
-#include <mutex>
 #include <cstdint>
 #include <cstring>
 #include <memory>
@@ -121,11 +124,23 @@ typedef struct GigEDeviceInfoStr {
 	str8		GateWay;
 } GigEDeviceInfoStr, *GigEDeviceInfoStrPtr, **GigEDeviceInfoStrHdl;
 
+typedef struct GigEStreamStatistics {
+	dbl			Bandwidth;				// bits/s
+	dbl			AcquisitionRate;		// blocks/s
+	i64			BlockCount;
+	i64			BlocksDropped;
+	i64			BlockIDsMissing;
+	i64			ResendGroupRequested;
+	i64			ResendPacketRequested;
+	u32			PipelineQueueDepth;		// filled buffers not yet retrieved
+} GigEStreamStatistics, *GigEStreamStatisticsPtr;
+
 class GIGE_API GigEDevice
 {
 private:
 	PvSystem				cSystem;
 	PvResult				cResult;
+	PvResult				cSerialResult;	// the serial port runs on its own thread, apart from cResult
 	PvResult				cAcqResult;
 	PvDevice				*cDevice;
 	PvGenParameterArray		*cDeviceParams;
@@ -152,16 +167,19 @@ private:
 	PvDeviceSerialPort		cPort;
 	u8						cUseTermChar;
 	u8						cTermChar;
-	fb_vec					cTransferBuffer;
+	SerialSimulator			*cSimulator;
+	std::vector<p_u8>		cTransferBuffer;
+	u32						cTransferBufferSize;
 	u32						cTransferBufferFrameCount;
-	std::queue <p_u8>		cAvailableTransferBuffer;
+	BufferAllocator			cTransferBufferAllocator;
+	SpscRing<p_u8>			cAvailableTransferBuffer;
+	std::vector<PvBuffer*>	cAttachedBuffers;
+	std::mutex				cAttachedBuffersLock;	// the statistics thread reads the count
 #ifdef __linux__
-	std::mutex			    cAvailableTransferBufferLock;
 	std::shared_ptr<AcqArmedCallback> cReadyCallBack;
 	std::shared_ptr<AcqFinishCallback> cFinishCallBack;
 	std::shared_ptr<TransferBufferReadyCallback> cBufferCallBack;
 #else
-	CRITICAL_SECTION		cAvailableTransferBufferLock;
 	p_readyCallBack			cFinishCallBack;
 	p_readyCallBack			cReadyCallBack;
 	p_bufferCallBack		cBufferCallBack;
@@ -169,17 +187,30 @@ private:
 	u64						cAcquiredImages;
 	u8						cContinuous;
 	u8						cStopAcquisition;
+	u8						cArmed;
 	dbl						cFrameTime;
 	u32						cFrameTimeOut;
+	i32						cBufferHandlingThreadPriority;
+	std::vector<int>		cBufferHandlingThreadCpus;
 
 public:
 	GigEDevice(const str8 aDeviceDescriptor);
 	~GigEDevice();
 
+	// keeps the cache line alignment of the transfer buffer ring on the heap
+	static void*			operator new( size_t Size );
+	static void				operator delete( void *Pointer );
+
 #ifdef __linux__
+	int32_t armAcq();
+	int32_t disarmAcq();
 	int32_t startAcq();
 	int32_t stopAcq();
-	int32_t retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut);
+	int32_t retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut, uint64_t &BlockId, uint64_t &Timestamp);
+	int32_t retrieveBuffer(uint32_t &BufferIndex, uint32_t FrameTimeOut, uint64_t &BlockId, uint64_t &Timestamp);
+	int32_t requeueBuffer(uint32_t BufferIndex);
+	int32_t reclaimBuffers(std::vector<uint32_t> &BufferIndices, std::vector<uint64_t> &BlockIds, std::vector<uint64_t> &Timestamps);
+	int32_t requeueBuffers(uint32_t FirstIndex);
 #endif
 	PvResult				GetLastResult();
 	i32						OpenSerialPort( PvDeviceSerial SerialPort, u32 RxBufferSize, u8 UseTermChar, u8 TermChar );
@@ -204,9 +235,18 @@ public:
 	i32						AcquireImageThread( u32 ImageCount, u32 FrameTimeOut );
 
 	i32						GetIntegerValue( const str8 Property, i64 &Value );
+	i32						GetTimestampTickFrequency( u64 &Frequency );
+	i32						GetStreamStatistics( GigEStreamStatistics &Statistics );
 	i32						GetBufferHandlingThreadPriority();
+	i32						SetBufferHandlingThreadPriority( i32 Priority );
+	void					SetBufferHandlingThreadAffinity( const std::vector<int> &Cpus );
 	void					SetTransferBuffer( u32 TransferBufferCount, u32 TransferBufferFrameCount );
+	void					SetBufferAllocation( u32 Flags, i32 NumaNode );
+	u32						GetBufferAllocation();
 	void					ReturnBuffer( p_u8 Buffer );
+	void					GetTransferBufferStatistics( u32 &HighWaterMark, u32 &LowWaterMark, u64 &Underruns );
+	i32						AttachBuffers( p_u8 *Buffers, u32 BufferCount, u32 BufferSize );
+	void					DetachBuffers();
 #ifdef __linux__
 	void					RegisterAcqArmedCallBack(std::shared_ptr<AcqArmedCallback>& cbk);
 	void					RegisterAcqFinishCallBack(std::shared_ptr<AcqFinishCallback>& cbk);
@@ -221,6 +261,7 @@ public:
 	void					SetFrameTime( dbl FrameTime );
 	void					SetFrameTimeOut( u32 FrameTimeOut );
 	
+	static u64				BlockIdGap( u64 Previous, u64 Current );
 	static i32				GetErrorDescription( PvResult aPleoraErrorCode,
 												 str8 aPleoraErrorCodeString,
 												 p_u32 aPleoraErrorCodeStringLen,
@@ -235,7 +276,11 @@ private:
 	PvResult				ConfigureSerialBulk( PvDeviceSerial SerialPort );
 	PvResult				ConfigureStream( bool TimeoutCountedAsError, bool AbortCountedAsError );
 	void					ClearQueue();
+	void					FreeTransferBuffers();
 	void					InitializeQueue();
+	PvResult				StartPipeline();
+	PvResult				RetrieveNextBuffer( PvBuffer **Buffer, u32 TimeOut, PvResult *OperationResult );
+	PvResult				SerialRead( p_u8 RxBuffer, u32 RxBufferSize, u32 &BytesRead, u32 TimeOut );
 	void					BufferReadyCallBack( p_u8 aTransferBuffer, u32 aCurrentFrameWithinBuffer );
 };
 
@@ -0,0 +1,86 @@
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <cstdint>
+
+namespace HexitecAPI {
+
+/**
+ * ASCII-hex codec for the serial protocol. Table driven, no allocation, and the
+ * single digit functions are constexpr so fixed commands can be built at compile time:
+ *
+ *   const uint8_t cmd[] = {0x23, MODULE_ADDRESS, 0x42, hexDigit(0x0a, 1), hexDigit(0x0a, 0), ...};
+ *
+ * Encoding matches the former stringstream implementation, including keeping the most
+ * significant digits when a number does not fit. Decoding stops at the first character
+ * that is not a hex digit.
+ */
+constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// 0xff marks characters that are not hex digits
+constexpr uint8_t HEX_VALUES[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+// digit at position (0 = least significant) of number as ASCII
+constexpr uint8_t hexDigit(uint32_t number, unsigned position) {
+	return (uint8_t) HEX_DIGITS[(number >> (4 * position)) & 0xf];
+}
+
+// number shifted right until it fits into digits, as a fixed width field keeps the leading digits
+constexpr uint32_t hexFit(uint32_t number, unsigned digits) {
+	return (digits < 8 && (number >> (4 * digits))) ? hexFit(number >> 4, digits) : number;
+}
+
+// compile time decoding of a literal, e.g. hexValue("0A", 2)
+constexpr uint32_t hexValue(const char* source, unsigned digits, uint32_t number = 0) {
+	return (digits == 0 || HEX_VALUES[(uint8_t) *source] == 0xff) ? number :
+			hexValue(source + 1, digits - 1, (number << 4) | HEX_VALUES[(uint8_t) *source]);
+}
+
+inline void encodeHex(uint32_t number, uint8_t digits, uint8_t* ptr) {
+	number = hexFit(number, digits);
+	for (unsigned i = digits; i > 0; i--) {
+		*ptr++ = hexDigit(number, i - 1);
+	}
+}
+
+// byte pairs in little endian order, e.g. 0x1234 as "3412"
+inline void encodeHexLE(uint32_t number, uint8_t digits, uint8_t* ptr) {
+	number = hexFit(number, digits);
+	for (unsigned i = 0; i < digits; i += 2) {
+		*ptr++ = hexDigit(number, i + 1);
+		*ptr++ = hexDigit(number, i);
+	}
+}
+
+inline uint32_t decodeHex(const uint8_t* source, uint8_t digits) {
+	uint32_t number = 0;
+	for (unsigned i = 0; i < digits; i++) {
+		uint8_t value = HEX_VALUES[source[i]];
+		if (value == 0xff) {
+			break;
+		}
+		number = (number << 4) | value;
+	}
+	return number;
+}
+
+} // namespace HexitecAPI
+
+#endif // HEX_CODEC_H
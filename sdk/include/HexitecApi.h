@@ -20,11 +20,22 @@
 #include <fstream>
 #include <functional>
 #include <mutex>
+#include <memory>
+#include <array>
+#include <bitset>
+#include <future>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <chrono>
 
 
 #ifndef COMPILE_HEXITEC_DUMMY
 #include <GigE.h>
 #endif
+#include <BlockId.h>
+#include <LatencyHistogram.h>
 
 namespace HexitecAPI {
 
@@ -54,6 +65,12 @@ const uint8_t FPGA_FW_CHECK_VERSION_REG = 0x82;
 const int FPGA_FW_CHECK_CUSTOMER_ERROR = 0x8;
 const int FPGA_FW_CHECK_PROJECT_ERROR = 0x9;
 const int FPGA_FW_CHECK_VERSION_ERROR = 0xA;
+const int REGISTER_VERIFY_ERROR = 0xB;
+const int REGISTER_COHERENCE_ERROR = 0xD;
+// registers below this address hold configuration and are shadowed, the ones above are status
+const int HEXITEC_SHADOW_REGISTER_COUNT = 0x80;
+const int SERIAL_DEADLINE_ERROR = 0xE;
+const int SERIAL_QUEUE_CLOSED_ERROR = 0xF;
 
 enum Control : uint8_t {
 	CONTROL_DISABLED = 0,
@@ -61,6 +78,18 @@ enum Control : uint8_t {
 };
 typedef enum Control Control;
 
+/**
+ * Order in which queued serial commands are sent. A command in flight is never
+ * interrupted, a higher priority one just goes ahead of everything still waiting.
+ */
+enum SerialPriority : uint8_t {
+	SERIAL_PRIORITY_TELEMETRY = 0,	///< environment and operating values
+	SERIAL_PRIORITY_NORMAL = 1,		///< configuration
+	SERIAL_PRIORITY_CONTROL = 2,	///< bias and trigger commands
+	SERIAL_PRIORITY_COUNT = 3
+};
+typedef enum SerialPriority SerialPriority;
+
 class FpgaRegister {
 public:
 	uint8_t address;
@@ -142,6 +171,24 @@ public:
 	std::string		GateWay;
 };
 
+class HexitecFrameInfo {
+public:
+	uint64_t	BlockId;	///< GVSP block ID of the frame
+	uint64_t	Timestamp;	///< device timestamp in ticks, see getTimestampTickFrequency
+};
+
+class HexitecStreamStatistics {
+public:
+	double		Bandwidth;				///< Mbit/s
+	double		AcquisitionRate;		///< frames/s received by the stream
+	int64_t		BlockCount;
+	int64_t		BlocksDropped;
+	int64_t		BlockIDsMissing;
+	int64_t		ResendGroupRequested;
+	int64_t		ResendPacketRequested;
+	uint32_t	PipelineQueueDepth;		///< frames received but not yet retrieved
+};
+
 class HexitecOperationMode {
 public:
 	Control DcUploadDarkCorrectionValues;
@@ -160,6 +207,46 @@ public:
 //	Control enTriggerMode;
 };
 
+/**
+ * One write/read transaction on the serial port. The buffers belong to the caller and
+ * must stay valid until the future returned by queueSerialCommand is ready.
+ */
+class SerialCommand {
+public:
+	const uint8_t*	txBuffer;
+	uint32_t		txBufferSize;
+	uint32_t		bytesWritten;
+	uint8_t*		rxBuffer;
+	uint32_t		rxBufferSize;
+	uint32_t		bytesRead;
+	std::chrono::steady_clock::time_point deadline;	///< not sent after this, epoch = no deadline
+	std::chrono::steady_clock::time_point queued;
+	std::promise<int32_t> result;
+};
+
+/**
+ * Serial transactions of one command code. Queue time runs from queueing to the worker
+ * taking the command, wire time covers flush, write and read. Both in microseconds.
+ */
+struct SerialStatistics {
+	uint64_t count = 0;
+	uint64_t errors = 0;
+	uint64_t bytesWritten = 0;
+	uint64_t bytesRead = 0;
+	LatencyHistogram queueTime;
+	LatencyHistogram wireTime;
+};
+
+/**
+ * Receives the filled transfer buffers of acquireFrames. The buffer is handed back
+ * to the acquisition loop as soon as bufferReady returns.
+ */
+class TransferBufferCallback {
+public:
+	virtual ~TransferBufferCallback() {}
+	virtual void bufferReady(uint8_t* transferBuffer, uint32_t frameCount) = 0;
+};
+
 class HexitecApi
 {
 public:
@@ -170,10 +257,19 @@ public:
 	int32_t createPipelineOnly(uint32_t bufferCount);
 	std::string getErrorDescription();
 	int32_t getFramesAcquired();
+	int32_t armAcq();
+	int32_t disarmAcq();
 	int32_t startAcq();
 	int32_t stopAcq();
 	int32_t setHvBiasOn(bool onOff);
 	int32_t retrieveBuffer(uint8_t* buffer, uint32_t frametimeout);
+	int32_t retrieveBuffer(uint8_t* buffer, uint32_t frametimeout, HexitecFrameInfo& frameInfo);
+	int32_t retrieveBuffer(uint32_t& bufferIndex, uint32_t frametimeout, HexitecFrameInfo& frameInfo);
+	int32_t requeueBuffer(uint32_t bufferIndex);
+	int32_t reclaimBuffers(std::vector<uint32_t>& bufferIndices, std::vector<HexitecFrameInfo>& frameInfo);
+	int32_t requeueBuffers(uint32_t firstIndex);
+	int32_t attachBuffers(std::vector<uint8_t*>& buffers, uint32_t bufferSize);
+	int32_t detachBuffers();
 	int32_t openSerialPortBulk0(uint32_t rxBufferSize, uint8_t useTermChar, uint8_t termChar);
 
 	int32_t acquireFrame(uint32_t& frameCount, uint8_t* buffer, uint32_t frametimeout);
@@ -184,14 +280,27 @@ public:
 	int32_t closeStream();
 	int32_t collectOffsetValues(uint32_t collectDctimeout);
 	int32_t configureDetector(uint8_t& width, uint8_t& height,double& frameTime, uint32_t& collectDcTime);
+	int32_t resumeConfiguration(uint8_t& width, uint8_t& height, double& frameTime, uint32_t& collectDcTime);
+	int32_t verifyConfiguration(bool& configured);
+	uint64_t getConfigurationHash();
 	void    copyBuffer(uint8_t* sourceBuffer, uint8_t* destBuffer, uint32_t byteCount);
 	int32_t createPipeline(uint32_t bufferCount, uint32_t transferBufferCount, uint32_t transferBufferFrameCount);
 	int32_t createPipelineOld(uint32_t bufferCount);
+	void    registerTransferBufferCallback(std::shared_ptr<TransferBufferCallback> cbk);
+	int32_t getTransferBufferStatistics(uint32_t& highWaterMark, uint32_t& lowWaterMark, uint64_t& underruns);
 	int32_t exitDevice();
 	int32_t getBufferHandlingThreadPriority(int32_t& priority);
+	int32_t setBufferHandlingThreadPriority(int32_t priority);
+	int32_t setBufferHandlingThreadAffinity(const std::vector<int>& cpus);
+	int32_t setBufferAllocation(uint32_t flags, int32_t numaNode);
+	int32_t getBufferAllocation(uint32_t& achieved);
 	int32_t getDeviceInformation(HexitecDeviceInfo& deviceInfoStr);
 	double  getFrameTime(uint8_t width, uint8_t height);
 	int32_t getIntegerValue(const std::string propertyName, int64_t &value);
+	int32_t getTimestampTickFrequency(uint64_t& frequency);
+	int32_t getStreamStatistics(HexitecStreamStatistics& statistics);
+	static uint64_t blockIdGap(uint64_t previous, uint64_t current);
+	static bool blockIdRestarted(uint64_t previous, uint64_t current);
 	int32_t getLastResult(uint32_t& internalErrorCode, std::string errorCodeString, std::string errorDescription);
 	int32_t getOperationMode(HexitecOperationMode& operationMode);
 	int32_t getSensorConfig(HexitecSensorConfig& sensorConfig);
@@ -213,7 +322,7 @@ public:
 	int32_t setTriggeredFrameCount(uint32_t frameCount);
 	int32_t stopAcquisition();
 	int32_t uploadOffsetValues(Reg2Byte* offsetValues, uint32_t offsetValuesLength);
-	int32_t checkTemperatureLimit(double& temperature);
+	int32_t checkTemperatureLimit(double& temperature, SerialPriority priority = SERIAL_PRIORITY_NORMAL);
     void    setBiasVoltage(int volts);
     void    getBiasVoltage(int& volts);
     void    setRefreshVoltage(int volts);
@@ -223,6 +332,12 @@ public:
     int32_t enableTriggerGate();
     int32_t enableTriggerMode();
     int32_t setTriggerCountingMode(bool enable);
+	int32_t resync();
+	void    setRegisterCoherenceCheck(bool enable);
+	std::future<int32_t> queueSerialCommand(std::shared_ptr<SerialCommand> command, SerialPriority priority);
+	void    setSerialDeadline(SerialPriority priority, uint32_t deadline);
+	void    getSerialStatistics(std::map<uint8_t, SerialStatistics>& statistics);
+	void    resetSerialStatistics();
 
 private:
 	std::string m_deviceDescriptor;
@@ -232,7 +347,25 @@ private:
 	HexitecSystemConfig m_systemConfig;
 	HexitecBiasConfig m_biasConfig;
 	std::ifstream m_file;
+	std::vector<uint8_t*> m_attachedBuffers;
+	uint32_t m_nextAttachedBuffer;
+	std::vector<uint8_t> m_transferBuffer;
+	uint32_t m_transferBufferFrameCount;
+	bool m_stopAcquisition;
+	uint64_t m_blockId;
+	std::shared_ptr<TransferBufferCallback> m_transferBufferCb;
 	std::mutex mutexLock;
+	std::mutex m_streamMutex;	///< held while the device, stream or pipeline is replaced and while its statistics are read
+	std::condition_variable m_serialCond;
+	std::array<std::deque<std::shared_ptr<SerialCommand>>, SERIAL_PRIORITY_COUNT> m_serialQueue;
+	std::array<uint32_t, SERIAL_PRIORITY_COUNT> m_serialDeadline;
+	std::thread m_serialThread;
+	bool m_serialRunning;
+	std::map<uint8_t, SerialStatistics> m_serialStatistics;
+	std::array<uint8_t, HEXITEC_SHADOW_REGISTER_COUNT> m_registerShadow;
+	std::bitset<HEXITEC_SHADOW_REGISTER_COUNT> m_registerShadowValid;
+	bool m_coherenceCheck;
+	uint64_t m_configurationHash;
 
 	#ifndef COMPILE_HEXITEC_DUMMY
 	class HexitecArmedCb : public GigE::AcqArmedCallback {
@@ -253,6 +386,15 @@ private:
 		HexitecApi& m_api;
 	};
 
+	class HexitecBufferReadyCb : public GigE::TransferBufferReadyCallback {
+	public:
+		HexitecBufferReadyCb(HexitecApi& api);
+		virtual ~HexitecBufferReadyCb();
+		void bufferReady(p_u8 aTransferBuffer, u32 aCurrentFrameWithinBuffer);
+	private:
+		HexitecApi& m_api;
+	};
+
 	GigE::GigEDevice *gigeDevice;
 
 	int32_t disableSM();
@@ -261,13 +403,27 @@ private:
 	int32_t enableSM();
 	int32_t enableSyncMode();
 	int32_t readRegister(uint8_t registerAddress, uint8_t& value);
+	int32_t readDeviceRegister(uint8_t registerAddress, uint8_t& value);
+	bool    shadowedRegister(uint8_t registerAddress, uint8_t& value);
+	void    shadowRegister(uint8_t registerAddress, uint8_t value, bool valid);
+	void    shadowRegisterBits(uint8_t registerAddress, uint8_t mask, bool set);
+	void    clearRegisterShadow();
 	int32_t readResolution(uint8_t& width, uint8_t& height);
+	int32_t readFrameTiming(uint8_t& width, uint8_t& height, double& frameTime, uint32_t& collectDcTime);
 	int32_t serialPortWriteRead(const uint8_t* txBuffer, uint32_t txBufferSize, uint32_t& bytesWritten, uint8_t* rxBuffer,
-			uint32_t rxBufferSize, uint32_t& bytesRead);
+			uint32_t rxBufferSize, uint32_t& bytesRead, SerialPriority priority = SERIAL_PRIORITY_NORMAL);
+	int32_t setDAC(double& vCal,double& uMid,double& hvSetPoint,double& detCtrl,double& targetTemperature,
+			SerialPriority priority);
+	void    startSerialWorker();
+	void    stopSerialWorker();
+	void    serialWorker();
 	int32_t setOperationMode(HexitecOperationMode operationMode);
 	int32_t writeAdcRegister(uint8_t registerAddress, uint8_t& value);
 	int32_t writeRegister(uint8_t registerAddress, uint8_t& value);
 	int32_t writeRegisterStream(FpgaRegisterVector &registerStream);
+	int32_t writeRegisters(const FpgaRegisterVector& registers);
+	void    systemConfigRegisters(FpgaRegisterVector& registers);
+	void    sensorConfigRegisters(const HexitecSensorConfig& sensorConfig, FpgaRegisterVector& registers);
 	int32_t returnBuffer(uint8_t* transferBuffer);
 
 	// helper functions
@@ -0,0 +1,304 @@
+// In-process model of the detector FPGA behind the serial port, so the command
+// encoding and sequencing of HexitecApi can run and be timed without hardware.
+#ifndef SERIAL_SIMULATOR_H
+#define SERIAL_SIMULATOR_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <HexCodec.h>
+
+#define SERIAL_SIMULATOR_DESCRIPTOR		"simulator"
+#define SERIAL_SIMULATOR_COMMAND_START	0x23
+#define SERIAL_SIMULATOR_REPLY_START	0x7e	// not checked by HexitecApi
+#define SERIAL_SIMULATOR_TERM_CHAR		0x0d
+#define SERIAL_SIMULATOR_BAUD_RATE		38400
+#define SERIAL_SIMULATOR_TURNAROUND		1000	// us between end of command and start of reply
+
+namespace GigE
+{
+/**
+ * Answers the register (0x40 write, 0x41 read, 0x42/0x43 set/clear bits, 0x46 stream),
+ * DAC (0x54, 0x56), ADC (0x53), function block (0x55), frame count (0x44), monitor
+ * (0x50 operating, 0x52 environment) and detector type (0x70) commands from a register
+ * map. Write blocks for the transmit time of the command at the UART baud rate, the
+ * reply becomes readable after the turnaround plus its own transmit time. Commands
+ * with a wrong start byte or an unknown code get no reply, like the real module.
+ * Not thread safe, GigEDevice serialises the port access.
+ */
+class SerialSimulator
+{
+public:
+	SerialSimulator()
+	{
+		memset( cRegisters, 0, sizeof( cRegisters ) );
+		cRegisters[0x80] = 0x01;	// customer
+		cRegisters[0x81] = 0x02;	// project
+		cRegisters[0x82] = 0x03;	// firmware version
+		cRegisters[0x83] = 80 / 4;	// width in groups of four columns
+		cRegisters[0x84] = 80;		// height
+		cRegisters[0x89] = 0x01;	// dark correction values collected
+
+		// 1.0 V Vcal, 1.0 V Umid, 0 V bias, 0 V DetCtrl, 20 C Peltier setpoint
+		cDac[0] = 0x0555;
+		cDac[1] = 0x0555;
+		cDac[2] = 0x0000;
+		cDac[3] = 0x0000;
+		cDac[4] = 0x0819;
+
+		// 23 C ambient, 30 %RH, 28 C ASIC, 30 C ADC, 3.3 V reference, 20 C NTC
+		const uint16_t lEnvironment[6] = { 0x65c3, 0x49ba, 0x01c0, 0x01e0, 0x19c6, 0x0819 };
+		// hvMon (from the bias DAC), 1.2, 1.8, 3.0, 2.5, 3.3, 1.65, 1.8, 3.8 V, 3.3 V reference, 0.5 A Peltier, 20 C NTC
+		const uint16_t lOperating[12] = { 0x0000, 0x05d1, 0x08ba, 0x0e8b, 0x0c1e, 0x0fff, 0x0800, 0x08ba, 0x126b, 0x19c6, 0x07c2, 0x0819 };
+		memcpy( cEnvironment, lEnvironment, sizeof( cEnvironment ) );
+		memcpy( cOperating, lOperating, sizeof( cOperating ) );
+
+		cDetectorType = 0x0001;
+		cBaudRate = SERIAL_SIMULATOR_BAUD_RATE;
+		cTurnaround = SERIAL_SIMULATOR_TURNAROUND;
+		cReplyOffset = 0;
+		cCommandCount = 0;
+	}
+
+	static bool IsSimulator( const std::string &DeviceDescriptor )
+	{
+		return DeviceDescriptor == SERIAL_SIMULATOR_DESCRIPTOR;
+	}
+
+	// BaudRate 0 removes the transmit time, Turnaround is in microseconds
+	void SetLatency( uint32_t BaudRate, uint32_t Turnaround )
+	{
+		cBaudRate = BaudRate;
+		cTurnaround = Turnaround;
+	}
+
+	uint8_t GetRegister( uint8_t Address ) const
+	{
+		return cRegisters[Address];
+	}
+
+	void SetRegister( uint8_t Address, uint8_t Value )
+	{
+		cRegisters[Address] = Value;
+	}
+
+	uint64_t GetCommandCount() const
+	{
+		return cCommandCount;
+	}
+
+	void Flush()
+	{
+		cReply.clear();
+		cReplyOffset = 0;
+	}
+
+	void Write( const uint8_t *TxBuffer, uint32_t TxBufferSize, uint32_t *BytesWritten )
+	{
+		std::this_thread::sleep_for( TransmitTime( TxBufferSize ) );
+		*BytesWritten = TxBufferSize;
+		cCommandCount++;
+		Flush();
+		if( Execute( TxBuffer, TxBufferSize ) )
+		{
+			cReplyReady = std::chrono::steady_clock::now() + std::chrono::microseconds( cTurnaround ) + TransmitTime( cReply.size() );
+		}
+		else
+		{
+			Flush();
+		}
+	}
+
+	// false on timeout
+	bool Read( uint8_t *RxBuffer, uint32_t RxBufferSize, uint32_t *BytesRead, uint32_t TimeOut )
+	{
+		*BytesRead = 0;
+		if( cReplyOffset >= cReply.size() )
+		{
+			std::this_thread::sleep_for( std::chrono::milliseconds( TimeOut ) );
+			return false;
+		}
+		if( cReplyReady > std::chrono::steady_clock::now() + std::chrono::milliseconds( TimeOut ) )
+		{
+			std::this_thread::sleep_for( std::chrono::milliseconds( TimeOut ) );
+			return false;
+		}
+		std::this_thread::sleep_until( cReplyReady );
+		*BytesRead = std::min<uint32_t>( RxBufferSize, cReply.size() - cReplyOffset );
+		memcpy( RxBuffer, &cReply[cReplyOffset], *BytesRead );
+		cReplyOffset += *BytesRead;
+		return true;
+	}
+
+private:
+	std::chrono::microseconds TransmitTime( size_t Bytes ) const
+	{
+		// 8N1, ten bits per character
+		return std::chrono::microseconds( cBaudRate ? ( Bytes * 10 * 1000000ULL ) / cBaudRate : 0 );
+	}
+
+	static uint32_t Hex( const uint8_t *Source, uint8_t Digits )
+	{
+		return HexitecAPI::decodeHex( Source, Digits );
+	}
+
+	void ReplyHex( uint32_t Value, uint8_t Digits )
+	{
+		size_t	lSize = cReply.size();
+
+		cReply.resize( lSize + Digits );
+		HexitecAPI::encodeHex( Value, Digits, &cReply[lSize] );
+	}
+
+	// hvMon follows the bias DAC: hv = -750 V * dac / 4095, hvOut = hvMon * 1621.65 - 1043.22
+	uint16_t HvMonitor() const
+	{
+		double	lHv = -750. * cDac[2] / 4095.;
+		double	lHvMon = ( lHv + 1043.22 ) / 1621.65;
+
+		return (uint16_t)( lHvMon * 4095. / 3.3 + 0.5 );
+	}
+
+	bool Execute( const uint8_t *Command, uint32_t Size )
+	{
+		// start, module address, code, arguments, terminator
+		if( ( Size < 4 ) || ( Command[0] != SERIAL_SIMULATOR_COMMAND_START ) || ( Command[Size - 1] != SERIAL_SIMULATOR_TERM_CHAR ) )
+		{
+			return false;
+		}
+		const uint8_t	*lArgs = Command + 3;
+		uint32_t		lArgSize = Size - 4;
+
+		cReply.push_back( SERIAL_SIMULATOR_REPLY_START );
+		cReply.push_back( Command[1] );
+		switch( Command[2] )
+		{
+			case 0x40:	// write register
+			case 0x42:	// set bits
+			case 0x43:	// clear bits
+			{
+				if( lArgSize < 4 )
+				{
+					return false;
+				}
+				uint8_t	lAddress = Hex( lArgs, 2 );
+				uint8_t	lValue = Hex( lArgs + 2, 2 );
+
+				if( Command[2] == 0x40 )
+				{
+					cRegisters[lAddress] = lValue;
+				}
+				else if( Command[2] == 0x42 )
+				{
+					cRegisters[lAddress] |= lValue;
+				}
+				else
+				{
+					cRegisters[lAddress] &= ~lValue;
+				}
+				ReplyHex( lAddress, 2 );
+				ReplyHex( cRegisters[lAddress], 2 );
+				break;
+			}
+			case 0x41:	// read register
+				if( lArgSize < 2 )
+				{
+					return false;
+				}
+				ReplyHex( cRegisters[Hex( lArgs, 2 )], 2 );
+				break;
+			case 0x44:	// triggered frame count, echoed
+				cReply.insert( cReply.end(), lArgs, lArgs + lArgSize );
+				break;
+			case 0x46:	// register stream
+			{
+				uint32_t	lCount = ( lArgSize >= 2 ) ? Hex( lArgs, 2 ) : 0;
+
+				if( ( lCount == 0 ) || ( lArgSize < 2 + lCount * 4 ) )
+				{
+					return false;
+				}
+				for( uint32_t i = 0 ; i < lCount ; i++ )
+				{
+					uint8_t	lAddress = Hex( lArgs + 2 + i * 4, 2 );
+
+					cRegisters[lAddress] = Hex( lArgs + 4 + i * 4, 2 );
+					ReplyHex( lAddress, 2 );
+					ReplyHex( cRegisters[lAddress], 2 );
+				}
+				break;
+			}
+			case 0x50:	// operating values
+				cOperating[0] = HvMonitor();
+				for( uint32_t i = 0 ; i < 12 ; i++ )
+				{
+					ReplyHex( cOperating[i], 4 );
+				}
+				break;
+			case 0x52:	// environment values
+				for( uint32_t i = 0 ; i < 6 ; i++ )
+				{
+					ReplyHex( cEnvironment[i], 4 );
+				}
+				break;
+			case 0x53:	// ADC register, echoed
+				if( lArgSize < 4 )
+				{
+					return false;
+				}
+				cReply.insert( cReply.end(), lArgs, lArgs + 4 );
+				break;
+			case 0x54:	// all DACs
+				if( lArgSize < 20 )
+				{
+					return false;
+				}
+				for( uint32_t i = 0 ; i < 5 ; i++ )
+				{
+					cDac[i] = Hex( lArgs + i * 4, 4 );
+					ReplyHex( cDac[i], 4 );
+				}
+				break;
+			case 0x55:	// function blocks, echoed
+				if( lArgSize < 2 )
+				{
+					return false;
+				}
+				cReply.insert( cReply.end(), lArgs, lArgs + 2 );
+				break;
+			case 0x56:	// bias DAC, read back without argument
+				if( lArgSize >= 4 )
+				{
+					cDac[2] = Hex( lArgs, 4 );
+				}
+				ReplyHex( cDac[2], 4 );
+				break;
+			case 0x70:	// detector type
+				ReplyHex( cDetectorType, 4 );
+				break;
+			default:
+				return false;
+		}
+		cReply.push_back( SERIAL_SIMULATOR_TERM_CHAR );
+		return true;
+	}
+
+	uint8_t					cRegisters[256];
+	uint16_t				cDac[5];
+	uint16_t				cEnvironment[6];
+	uint16_t				cOperating[12];
+	uint16_t				cDetectorType;
+	uint32_t				cBaudRate;
+	uint32_t				cTurnaround;
+	std::vector<uint8_t>	cReply;
+	size_t					cReplyOffset;
+	std::chrono::steady_clock::time_point	cReplyReady;
+	uint64_t				cCommandCount;
+};
+
+} // namespace GigE
+#endif // SERIAL_SIMULATOR_H
@@ -0,0 +1,147 @@
+// Bounded single producer / single consumer ring used to recycle the transfer
+// buffers between the acquisition loop and the consumer returning them.
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#define SPSC_RING_CACHE_LINE_SIZE 64
+
+namespace GigE
+{
+/**
+ * Push must only be called from one thread and Pop from one other thread; both are
+ * wait-free. Resize and Clear must only be called while neither side is active.
+ * Head and tail live on separate cache lines together with the statistics written
+ * by the same side, so producer and consumer never write to a shared line. The
+ * alignment only holds on the heap when the owner is allocated aligned, plain new
+ * does not guarantee it before C++17 (see GigEDevice::operator new).
+ */
+template <typename T>
+class SpscRing
+{
+public:
+	SpscRing()
+	{
+		cMask = 0;
+		Clear();
+	}
+
+	// capacity is rounded up to the next power of two
+	void Resize( size_t Capacity )
+	{
+		size_t	lSize = 1;
+
+		while( lSize < Capacity )
+		{
+			lSize <<= 1;
+		}
+		cSlots.assign( lSize, T() );
+		cMask = lSize - 1;
+		Clear();
+	}
+
+	void Clear()
+	{
+		cHead.store( 0, std::memory_order_relaxed );
+		cTail.store( 0, std::memory_order_relaxed );
+		cHighWaterMark.store( 0, std::memory_order_relaxed );
+		cLowWaterMark.store( cSlots.size(), std::memory_order_relaxed );
+		cPushFailures.store( 0, std::memory_order_relaxed );
+		cPopFailures.store( 0, std::memory_order_relaxed );
+	}
+
+	bool Push( const T &Value )
+	{
+		size_t	lTail = cTail.load( std::memory_order_relaxed );
+		size_t	lHead = cHead.load( std::memory_order_acquire );
+
+		if( lTail - lHead >= cSlots.size() )
+		{
+			cPushFailures.store( cPushFailures.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+			return false;
+		}
+		cSlots[lTail & cMask] = Value;
+		cTail.store( lTail + 1, std::memory_order_release );
+
+		if( lTail + 1 - lHead > cHighWaterMark.load( std::memory_order_relaxed ) )
+		{
+			cHighWaterMark.store( lTail + 1 - lHead, std::memory_order_relaxed );
+		}
+		return true;
+	}
+
+	bool Pop( T &Value )
+	{
+		size_t	lHead = cHead.load( std::memory_order_relaxed );
+		size_t	lTail = cTail.load( std::memory_order_acquire );
+
+		if( lHead == lTail )
+		{
+			cPopFailures.store( cPopFailures.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+			cLowWaterMark.store( 0, std::memory_order_relaxed );
+			return false;
+		}
+		Value = cSlots[lHead & cMask];
+		cHead.store( lHead + 1, std::memory_order_release );
+
+		if( lTail - lHead - 1 < cLowWaterMark.load( std::memory_order_relaxed ) )
+		{
+			cLowWaterMark.store( lTail - lHead - 1, std::memory_order_relaxed );
+		}
+		return true;
+	}
+
+	size_t Size() const
+	{
+		return cTail.load( std::memory_order_acquire ) - cHead.load( std::memory_order_acquire );
+	}
+
+	size_t Capacity() const
+	{
+		return cSlots.size();
+	}
+
+	// most elements ever held since the last Clear
+	size_t HighWaterMark() const
+	{
+		return cHighWaterMark.load( std::memory_order_relaxed );
+	}
+
+	// fewest elements left after a Pop since the last Clear
+	size_t LowWaterMark() const
+	{
+		return cLowWaterMark.load( std::memory_order_relaxed );
+	}
+
+	uint64_t PushFailures() const
+	{
+		return cPushFailures.load( std::memory_order_relaxed );
+	}
+
+	uint64_t PopFailures() const
+	{
+		return cPopFailures.load( std::memory_order_relaxed );
+	}
+
+private:
+	// consumer side
+	alignas( SPSC_RING_CACHE_LINE_SIZE ) std::atomic<size_t>	cHead;
+	std::atomic<size_t>		cLowWaterMark;
+	std::atomic<uint64_t>	cPopFailures;
+	char					cPadHead[SPSC_RING_CACHE_LINE_SIZE - 2 * sizeof( std::atomic<size_t> ) - sizeof( std::atomic<uint64_t> )];
+	// producer side
+	alignas( SPSC_RING_CACHE_LINE_SIZE ) std::atomic<size_t>	cTail;
+	std::atomic<size_t>		cHighWaterMark;
+	std::atomic<uint64_t>	cPushFailures;
+	char					cPadTail[SPSC_RING_CACHE_LINE_SIZE - 2 * sizeof( std::atomic<size_t> ) - sizeof( std::atomic<uint64_t> )];
+	// read only while active
+	std::vector<T>			cSlots;
+	size_t					cMask;
+};
+
+} // namespace GigE
+#endif // SPSC_RING_H
@@ -1047,3 +1047,39 @@
 //
 #define AS_COLLECT_DC_NOT_READY          ((DWORD)0xC4000020L)
 
+//
+// MessageId: AS_GIGE_ATTACH_BUFFER_ERROR
+//
+// MessageText:
+//
+// Could not attach the external buffer to the stream (GigE Lib: %1!d!). 
+//
+#define AS_GIGE_ATTACH_BUFFER_ERROR      ((DWORD)0xC4000021L)
+
+//
+// MessageId: AS_GIGE_QUEUE_BUFFER_ERROR
+//
+// MessageText:
+//
+// Could not queue the buffer into the stream (GigE Lib: %1!d!). 
+//
+#define AS_GIGE_QUEUE_BUFFER_ERROR       ((DWORD)0xC4000022L)
+
+//
+// MessageId: AS_GIGE_SET_THREAD_PRIORITY_ERROR
+//
+// MessageText:
+//
+// Could not set the priority of the buffer handling thread (GigE Lib: %1!d!). 
+//
+#define AS_GIGE_SET_THREAD_PRIORITY_ERROR ((DWORD)0xC4000023L)
+
+//
+// MessageId: AS_GIGE_SIMULATED_DEVICE
+//
+// MessageText:
+//
+// Not available on the simulated device (GigE Lib: %1!d!). 
+//
+#define AS_GIGE_SIMULATED_DEVICE ((DWORD)0xC4000024L)
+
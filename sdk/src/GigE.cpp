@@ -8,31 +8,93 @@
 #ifndef COMPILE_HEXITEC_DUMMY
 #include <cmath>
 #include <iostream>
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#else
+#include <malloc.h>
+#endif
 
 #ifdef __linux__ // Changes added for Linux -------------------------------------------------------------------------------------
 
 using namespace GigE;
 
 
-int32_t GigEDevice::startAcq() {
+/**
+ * Does everything startAcq needs except the start command: reset, queueing the attached
+ * buffers or starting the pipeline, and enabling the stream. startAcq then only has to
+ * issue the start command. Undone by disarmAcq, which stopAcq also calls.
+ */
+int32_t GigEDevice::armAcq() {
 	if (!cStream) {
 		return AS_GIGE_STREAM_NOT_AVAILABLE;
 	}
 	if (!cPipeline) {
 		return AS_GIGE_PIPELINE_NOT_AVAILABLE;
 	}
+	if (cArmed) {
+		return AS_NO_ERROR;
+	}
 	cResult = cResetCmd->Execute();
 	if (!cResult.IsOK()) {
 		return AS_GIGE_RESET_COMMAND_ERROR;
 	}
-	cResult = cPipeline->Start();
-	if (!cResult.IsOK()) {
-		return AS_GIGE_PIPELINE_START_ERROR;
+	cStopAcquisition = 0;
+	// from here on disarmAcq has to clean up, even after a partial arm
+	cArmed = 1;
+	if (cAttachedBuffers.size()) {
+		// zero copy: the stream writes straight into the attached buffers
+		for (auto lBuffer : cAttachedBuffers) {
+			cResult = cStream->QueueBuffer(lBuffer);
+			if (!cResult.IsOK()) {
+				return AS_GIGE_QUEUE_BUFFER_ERROR;
+			}
+		}
+	} else {
+		cResult = StartPipeline();
+		if (!cResult.IsOK()) {
+			return AS_GIGE_PIPELINE_START_ERROR;
+		}
 	}
 	cResult = cDevice->StreamEnable();
 	if (!cResult.IsOK()) {
 		return AS_GIGE_STREAM_ENABLE_ERROR;
 	}
+	return AS_NO_ERROR;
+}
+
+int32_t GigEDevice::disarmAcq() {
+	if (!cArmed) {
+		return AS_NO_ERROR;
+	}
+	cArmed = 0;
+	cResult = cDevice->StreamDisable();
+	if (!cResult.IsOK()) {
+		return AS_GIGE_STREAM_DISABLE_ERROR;
+	}
+	if (cAttachedBuffers.size()) {
+		PvBuffer *lBuffer = NULL;
+		PvResult lResult;
+		// all queued buffers have to be retrieved before they can be queued again
+		cStream->AbortQueuedBuffers();
+		while (cStream->GetQueuedBufferCount() > 0) {
+			cStream->RetrieveBuffer(&lBuffer, &lResult);
+		}
+	} else {
+		cResult = cPipeline->Stop();
+		if (!cResult.IsOK()) {
+			return AS_GIGE_PIPELINE_STOP_ERROR;
+		}
+	}
+	return AS_NO_ERROR;
+}
+
+int32_t GigEDevice::startAcq() {
+	int32_t lResult = armAcq();
+	if (lResult != AS_NO_ERROR) {
+		return lResult;
+	}
 	cResult = cStartCmd->Execute();
 	if (!cResult.IsOK()) {
 		return AS_GIGE_START_COMMAND_ERROR;
@@ -41,17 +103,16 @@ int32_t GigEDevice::startAcq() {
 }
 
 int32_t GigEDevice::stopAcq() {
+	if (cSimulator) {
+		return AS_GIGE_SIMULATED_DEVICE;
+	}
 	cResult = cStopCmd->Execute();
 	if (!cResult.IsOK()) {
 		return AS_GIGE_STOP_COMMAND_ERROR;
 	}
-	cResult = cDevice->StreamDisable();
-	if (!cResult.IsOK()) {
-		return AS_GIGE_STREAM_DISABLE_ERROR;
-	}
-	cResult = cPipeline->Stop();
-	if (!cResult.IsOK()) {
-		return AS_GIGE_PIPELINE_STOP_ERROR;
+	int32_t lResult = disarmAcq();
+	if (lResult != AS_NO_ERROR) {
+		return lResult;
 	}
 	if (!cAcqResult.IsOK()) {
 		cResult = cAcqResult;
@@ -60,7 +121,7 @@ int32_t GigEDevice::stopAcq() {
 	return AS_NO_ERROR;
 }
 
-int32_t GigEDevice::retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut) {
+int32_t GigEDevice::retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut, uint64_t &BlockId, uint64_t &Timestamp) {
 	PvResult lResult;
 	PvPayloadType lType;
 	PvBuffer *lBuffer = NULL;
@@ -68,7 +129,7 @@ int32_t GigEDevice::retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut) {
 	uint32_t lSize = 0;
 	uint8_t* lPointer = buffer;
 
-	cResult = cPipeline->RetrieveNextBuffer(&lBuffer, FrameTimeOut, &lResult);
+	cResult = RetrieveNextBuffer(&lBuffer, FrameTimeOut, &lResult);
 	if (cResult.IsOK()) {
 		if (lResult.IsOK()) {
 			lType = lBuffer->GetPayloadType();
@@ -78,6 +139,8 @@ int32_t GigEDevice::retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut) {
 				// ToDo really need to avoid this by passing in the supplied buffer
 				memcpy(lPointer, lRawBuffer, lSize);
 				lPointer = lPointer + lSize;
+				BlockId = lBuffer->GetBlockID();
+				Timestamp = lBuffer->GetTimestamp();
 			} else {
 				cResult = PvResult::Code::INVALID_DATA_FORMAT;
 			}
@@ -93,6 +156,87 @@ int32_t GigEDevice::retrieveBuffer(uint8_t *buffer, uint32_t FrameTimeOut) {
 	return cResult.GetCode();
 }
 
+/**
+ * Zero copy variant: the frame is left in the attached buffer returned in BufferIndex,
+ * which has to be handed back with requeueBuffer once it has been consumed.
+ */
+int32_t GigEDevice::retrieveBuffer(uint32_t &BufferIndex, uint32_t FrameTimeOut, uint64_t &BlockId, uint64_t &Timestamp) {
+	PvResult lResult;
+	PvBuffer *lBuffer = NULL;
+
+	cResult = RetrieveNextBuffer(&lBuffer, FrameTimeOut, &lResult);
+	if (cResult.IsOK()) {
+		BufferIndex = (uint32_t)lBuffer->GetID();
+		BlockId = lBuffer->GetBlockID();
+		Timestamp = lBuffer->GetTimestamp();
+		if (!lResult.IsOK()) {
+			cResult = lResult;
+		} else if (lBuffer->GetPayloadType() != PvPayloadTypeImage) {
+			cResult = PvResult::Code::INVALID_DATA_FORMAT;
+		}
+		if (!cResult.IsOK()) {
+			cStream->QueueBuffer(lBuffer);
+		}
+	}
+	return cResult.GetCode();
+}
+
+int32_t GigEDevice::requeueBuffer(uint32_t BufferIndex) {
+	if (BufferIndex >= cAttachedBuffers.size()) {
+		return AS_GIGE_QUEUE_BUFFER_ERROR;
+	}
+	cResult = cStream->QueueBuffer(cAttachedBuffers[BufferIndex]);
+	if (!cResult.IsOK()) {
+		return AS_GIGE_QUEUE_BUFFER_ERROR;
+	}
+	return AS_NO_ERROR;
+}
+
+/**
+ * Zero copy: takes the queued buffers back from the stream, all attached buffers belong
+ * to the caller until requeueBuffers. Buffers the stream had completed but not handed
+ * out yet are returned in BufferIndices, in the order they were filled, with their
+ * block IDs and timestamps; the others come back empty. Frames arriving in between
+ * are lost.
+ */
+int32_t GigEDevice::reclaimBuffers(std::vector<uint32_t> &BufferIndices, std::vector<uint64_t> &BlockIds, std::vector<uint64_t> &Timestamps) {
+	PvBuffer *lBuffer = NULL;
+	PvResult lResult;
+
+	BufferIndices.clear();
+	BlockIds.clear();
+	Timestamps.clear();
+	cResult = cStream->AbortQueuedBuffers();
+	if (!cResult.IsOK()) {
+		return AS_GIGE_QUEUE_BUFFER_ERROR;
+	}
+	while (cStream->GetQueuedBufferCount() > 0) {
+		if (cStream->RetrieveBuffer(&lBuffer, &lResult).IsOK() && lResult.IsOK()
+				&& (lBuffer->GetPayloadType() == PvPayloadTypeImage)) {
+			BufferIndices.push_back((uint32_t)lBuffer->GetID());
+			BlockIds.push_back(lBuffer->GetBlockID());
+			Timestamps.push_back(lBuffer->GetTimestamp());
+		}
+	}
+	return AS_NO_ERROR;
+}
+
+/**
+ * Zero copy: queues all attached buffers in ring order from FirstIndex, so the stream
+ * fills them in step with the frame numbers again.
+ */
+int32_t GigEDevice::requeueBuffers(uint32_t FirstIndex) {
+	uint32_t lCount = cAttachedBuffers.size();
+
+	for (uint32_t i = 0; i < lCount; i++) {
+		cResult = cStream->QueueBuffer(cAttachedBuffers[(FirstIndex + i) % lCount]);
+		if (!cResult.IsOK()) {
+			return AS_GIGE_QUEUE_BUFFER_ERROR;
+		}
+	}
+	return AS_NO_ERROR;
+}
+
 void GigEDevice::RegisterAcqArmedCallBack(std::shared_ptr<AcqArmedCallback>& aAcqArmedCallBack)
 {
 	cReadyCallBack = aAcqArmedCallBack;
@@ -108,11 +252,39 @@ void GigEDevice::RegisterTransferBufferReadyCallBack(std::shared_ptr<TransferBuf
 #endif // End of specific Linux changes -------------------------------------------------------------------------------------
 
 
-GigEDevice::~GigEDevice() 
+void* GigEDevice::operator new( size_t Size )
 {
-#ifndef __linux__
-	DeleteCriticalSection( &cAvailableTransferBufferLock );
+	void	*lPointer = NULL;
+
+#ifdef __linux__
+	if( posix_memalign( &lPointer, alignof( GigEDevice ), Size ) )
+	{
+		lPointer = NULL;
+	}
+#else
+	lPointer = _aligned_malloc( Size, alignof( GigEDevice ) );
 #endif
+	if( lPointer == NULL )
+	{
+		throw std::bad_alloc();
+	}
+	return lPointer;
+}
+
+void GigEDevice::operator delete( void *Pointer )
+{
+#ifdef __linux__
+	free( Pointer );
+#else
+	_aligned_free( Pointer );
+#endif
+}
+
+GigEDevice::~GigEDevice() 
+{
+	DetachBuffers();
+	FreeTransferBuffers();
+
 	if (cPort.IsOpened())
 	{
 		cPort.Close();
@@ -132,6 +304,8 @@ GigEDevice::~GigEDevice()
 
 		PvDevice::Free( cDevice );
 	}
+
+	delete cSimulator;
 }
 
 i32	GigEDevice::AcquireImage( p_u32 ImageCount, p_u8 Buffer, u32 FrameTimeOut )
@@ -145,6 +319,9 @@ i32	GigEDevice::AcquireImage( p_u32 ImageCount, p_u8 Buffer, u32 FrameTimeOut )
 	u32				lImageCount = *ImageCount;
 	p_u8			lPointer = Buffer;
 	u32				lTimeOut = FrameTimeOut;
+	u64				lBlockId = 0;
+	u64				lPreviousBlockId = 0;
+	u8				lBlockIdValid = 0;
 
 	cAcqResult = PvResult::Code::OK;
 
@@ -165,7 +342,7 @@ i32	GigEDevice::AcquireImage( p_u32 ImageCount, p_u8 Buffer, u32 FrameTimeOut )
 		return AS_GIGE_RESET_COMMAND_ERROR;
 	}	
 	
-	cResult = cPipeline->Start();
+	cResult = StartPipeline();
 
 	if( !cResult.IsOK() )
 	{
@@ -211,6 +388,7 @@ i32	GigEDevice::AcquireImage( p_u32 ImageCount, p_u8 Buffer, u32 FrameTimeOut )
 					lSize = lBuffer->GetSize();
 
 					memcpy( lPointer, lRawBuffer, lSize );
+					lBlockId = lBuffer->GetBlockID();
 					
 					if (!i)
 					{
@@ -240,24 +418,16 @@ i32	GigEDevice::AcquireImage( p_u32 ImageCount, p_u8 Buffer, u32 FrameTimeOut )
 				cPipeline->ReleaseBuffer( lBuffer );
 			}
 
+			// a dropped or missing block shows up as a gap in the block IDs
 			if( cAcqResult.IsOK() )
 			{
-				cAcqResult = cBlocksDropped->GetValue( cBlocksDroppedVal );
-
-				if( cAcqResult.IsOK() && cBlocksDroppedVal )
-				{
-					cAcqResult = PvResult::Code::ABORTED;
-				}
-			}
-
-			if( cAcqResult.IsOK() )
-			{
-				cAcqResult = cBlockIDsMissing->GetValue( cBlockIDsMissingVal );
-
-				if( cAcqResult.IsOK() && cBlockIDsMissingVal )
+				if( lBlockIdValid && BlockIdGap( lPreviousBlockId, lBlockId ) )
 				{
 					cAcqResult = PvResult::Code::ERR_OVERFLOW;
 				}
+
+				lPreviousBlockId = lBlockId;
+				lBlockIdValid = 1;
 			}
 		}
 	}
@@ -315,6 +485,9 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 	p_u8			lPointer = NULL;
 	i32				lResult = AS_NO_ERROR;
 	u32				lTimeOut = FrameTimeOut;
+	u64				lBlockId = 0;
+	u64				lPreviousBlockId = 0;
+	u8				lBlockIdValid = 0;
 
 	cAcqResult = PvResult::Code::OK;
 	
@@ -349,7 +522,7 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 		return AS_GIGE_RESET_COMMAND_ERROR;
 	}
 
-	cResult = cPipeline->Start();
+	cResult = StartPipeline();
 
 	if( !cResult.IsOK() )
 	{
@@ -390,35 +563,24 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 		
 		if( lCurrentFrameWithinBuffer == 0 )	// new Transferbuffer
 		{
-#ifdef __linux__
-			cAvailableTransferBufferLock.lock();
-#else
-			EnterCriticalSection( &cAvailableTransferBufferLock );
-#endif
-			if (cAvailableTransferBuffer.size())
+			if( cAvailableTransferBuffer.Pop( lTransferBuffer ) )
 			{
-				lTransferBuffer = cAvailableTransferBuffer.front();
 				lPointer = lTransferBuffer;
-				cAvailableTransferBuffer.pop();
-#ifdef __linux__
-	            cAvailableTransferBufferLock.unlock();
-#else
-				LeaveCriticalSection( &cAvailableTransferBufferLock );
-#endif
 			}
 			else
 			{
-#ifdef __linux__
-	            cAvailableTransferBufferLock.unlock();
-#else
-				LeaveCriticalSection( &cAvailableTransferBufferLock );
-#endif
 				lResult = AS_GIGE_NO_TRANSFER_BUFFER_AVAILABLE;
 				break;
 			}
 		}
 		
-		cAcqResult = cPipeline->RetrieveNextBuffer( &lBuffer, lTimeOut, &lAcqResult );
+		cAcqResult = RetrieveNextBuffer( &lBuffer, lTimeOut, &lAcqResult );
+
+		if( cAcqResult == PvResult::Code::ABORTED )
+		{
+			cAcqResult = PvResult::Code::OK;
+			break;
+		}
 	
 		if( cAcqResult.IsOK() )
 		{
@@ -432,6 +594,7 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 					lSize = lBuffer->GetSize();
 
 					std::copy( lRawBuffer, lRawBuffer + lSize, lPointer );
+					lBlockId = lBuffer->GetBlockID();
 					
 					lCurrentFrameWithinBuffer++;
 
@@ -469,26 +632,17 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 				cPipeline->ReleaseBuffer( lBuffer );
 			}
 			
+			// a dropped or missing block shows up as a gap in the block IDs
 			if( cAcqResult.IsOK() )
 			{
-				cAcqResult = cBlocksDropped->GetValue( cBlocksDroppedVal );
-
-				if( cAcqResult.IsOK() && cBlocksDroppedVal )
-				{
-					lResult = AS_GIGE_BLOCKS_DROPPED;
-					break;
-				}
-			}
-
-			if( cAcqResult.IsOK() )
-			{
-				cAcqResult = cBlockIDsMissing->GetValue( cBlockIDsMissingVal );
-
-				if( cAcqResult.IsOK() && cBlockIDsMissingVal )
+				if( lBlockIdValid && BlockIdGap( lPreviousBlockId, lBlockId ) )
 				{
 					lResult = AS_GIGE_BLOCKS_IDS_MISSING;
 					break;
 				}
+
+				lPreviousBlockId = lBlockId;
+				lBlockIdValid = 1;
 			}
 		}
 	}
@@ -539,6 +693,50 @@ i32	GigEDevice::AcquireImageThread( u32 ImageCount, u32 FrameTimeOut )
 	return lResult;
 }
 
+i32 GigEDevice::AttachBuffers( p_u8 *Buffers, u32 BufferCount, u32 BufferSize )
+{
+	PvBuffer	*lBuffer = NULL;
+
+	if( !cStream )
+	{
+		return AS_GIGE_STREAM_NOT_AVAILABLE;
+	}
+
+	DetachBuffers();
+
+	if( BufferSize < cDevice->GetPayloadSize() )
+	{
+		return AS_BUFFER_TO_SMALL;
+	}
+
+	for( u32 i=0 ; i<BufferCount ; i++ )
+	{
+		lBuffer = new PvBuffer();
+		cResult = lBuffer->Attach( Buffers[i], BufferSize );
+
+		if( !cResult.IsOK() )
+		{
+			delete lBuffer;
+			DetachBuffers();
+			return AS_GIGE_ATTACH_BUFFER_ERROR;
+		}
+
+		lBuffer->SetID( i );
+		std::lock_guard<std::mutex> lLock( cAttachedBuffersLock );
+		cAttachedBuffers.push_back( lBuffer );
+	}
+
+	return AS_NO_ERROR;
+}
+
+/**
+ * Number of blocks missing between two consecutive block IDs, see BlockId.h.
+ */
+u64 GigEDevice::BlockIdGap( u64 Previous, u64 Current )
+{
+	return GigE::BlockIdGap( Previous, Current );
+}
+
 void GigEDevice::BufferReadyCallBack( p_u8 aTransferBuffer, u32 aCurrentFrameWithinBuffer )
 {
 	if ( cBufferCallBack )
@@ -547,24 +745,13 @@ void GigEDevice::BufferReadyCallBack( p_u8 aTransferBuffer, u32 aCurrentFrameWit
 	}
 	else
 	{
-#ifdef __linux__
-        cAvailableTransferBufferLock.lock();
-		cAvailableTransferBuffer.push(aTransferBuffer);
-        cAvailableTransferBufferLock.unlock();
-#else
-		EnterCriticalSection( &cAvailableTransferBufferLock );
-		cAvailableTransferBuffer.push(aTransferBuffer);
-		LeaveCriticalSection( &cAvailableTransferBufferLock );
-#endif
+		cAvailableTransferBuffer.Push( aTransferBuffer );
 	}
 }
 
 void GigEDevice::ClearQueue()
 {
-	while( cAvailableTransferBuffer.size() )
-	{
-		cAvailableTransferBuffer.pop();
-	}
+	cAvailableTransferBuffer.Clear();
 }
 
 i32	GigEDevice::ClosePipeline()
@@ -576,6 +763,10 @@ i32	GigEDevice::ClosePipeline()
 		return AS_NO_ERROR;
 	}
 
+#ifdef __linux__
+	disarmAcq();
+#endif
+
 	if( cPipeline->IsStarted() )
 	{
 		cResult = cPipeline->Stop();
@@ -593,9 +784,15 @@ i32	GigEDevice::ClosePipeline()
 
 i32 GigEDevice::CloseSerialPort()
 {
-	cResult = cPort.Close();
+	if( cSimulator )
+	{
+		cSimulator->Flush();
+		return AS_NO_ERROR;
+	}
 
-	if( !cResult.IsOK() )
+	cSerialResult = cPort.Close();
+
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_CLOSE_ERROR;
 	}
@@ -607,6 +804,8 @@ i32 GigEDevice::CloseStream()
 {
 	i32	lResult = AS_NO_ERROR;
 	
+	DetachBuffers();
+
 	if( cPipeline )
 	{
 		lResult = ClosePipeline();
@@ -717,15 +916,21 @@ i32	GigEDevice::CreatePipeline( u32 BufferCount )
 
 	NeededBufferSize = cDevice->GetPayloadSize();
 
+	if( cTransferBufferSize != cTransferBufferFrameCount * NeededBufferSize )
+	{
+		// the contents are overwritten before use, so the buffers are kept across pipelines
+		FreeTransferBuffers();
+		cTransferBufferSize = cTransferBufferFrameCount * NeededBufferSize;
+	}
 	for ( u32 i=0 ; i<cTransferBuffer.size() ; i++ )
 	{
-		try
-		{
-			cTransferBuffer[i].resize( cTransferBufferFrameCount * NeededBufferSize , 0 );
-		}
-		catch( std::bad_alloc )
+		if( !cTransferBuffer[i] && cTransferBufferSize )
 		{
-			cResult = PvResult::Code::NOT_ENOUGH_MEMORY;
+			cTransferBuffer[i] = cTransferBufferAllocator.Allocate( cTransferBufferSize );
+			if( !cTransferBuffer[i] )
+			{
+				cResult = PvResult::Code::NOT_ENOUGH_MEMORY;
+			}
 		}
 	}
 
@@ -735,9 +940,14 @@ i32	GigEDevice::CreatePipeline( u32 BufferCount )
 		cResult = cPipeline->SetBufferCount( BufferCount );
 	}
 
+	if( cResult.IsOK() && ( cBufferHandlingThreadPriority >= 0 ) )
+	{
+		cResult = cPipeline->SetBufferHandlingThreadPriority( cBufferHandlingThreadPriority );
+	}
+
 	if( !cResult.IsOK() )
 	{
-		cTransferBuffer.clear();
+		FreeTransferBuffers();
 		delete cPipeline;
 		cPipeline = NULL;
 		return AS_GIGE_PIPELINE_CREATION_ERROR;
@@ -746,11 +956,29 @@ i32	GigEDevice::CreatePipeline( u32 BufferCount )
 	return AS_NO_ERROR;
 }
 
+void GigEDevice::DetachBuffers()
+{
+	std::lock_guard<std::mutex> lLock( cAttachedBuffersLock );
+
+	for( u32 i=0 ; i<cAttachedBuffers.size() ; i++ )
+	{
+		cAttachedBuffers[i]->Detach();
+		delete cAttachedBuffers[i];
+	}
+	cAttachedBuffers.clear();
+}
+
 i32	GigEDevice::FlushRxBuffer()
 {
-	cResult = cPort.FlushRxBuffer();
+	if( cSimulator )
+	{
+		cSimulator->Flush();
+		return AS_NO_ERROR;
+	}
 
-	if( !cResult.IsOK() )
+	cSerialResult = cPort.FlushRxBuffer();
+
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_FLUSH_ERROR;
 	}
@@ -836,6 +1064,11 @@ i32 GigEDevice::GetIntegerValue( const str8 Property, i64 &Value )
 {
 	i32 lResult = AS_NO_ERROR;
 	
+	if( cSimulator )
+	{
+		return AS_GIGE_SIMULATED_DEVICE;
+	}
+
 	cResult = cStreamParams->GetIntegerValue( Property, Value );
 
 	if( !cResult.IsOK() )
@@ -846,11 +1079,111 @@ i32 GigEDevice::GetIntegerValue( const str8 Property, i64 &Value )
 	return lResult;
 }
 
+/**
+ * Reads the stream statistics, meant to be polled from a thread other than the one
+ * retrieving the buffers.
+ */
+i32 GigEDevice::GetStreamStatistics( GigEStreamStatistics &Statistics )
+{
+	if( !cStream )
+	{
+		return AS_GIGE_STREAM_NOT_AVAILABLE;
+	}
+
+	// runs on the statistics thread, cResult belongs to the acquisition thread
+	PvResult	lResult = cStreamParams->GetFloatValue( "Bandwidth", Statistics.Bandwidth );
+	size_t		lAttachedCount;
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetFloatValue( "AcquisitionRate", Statistics.AcquisitionRate );
+	}
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetIntegerValue( "BlockCount", Statistics.BlockCount );
+	}
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetIntegerValue( "BlocksDropped", Statistics.BlocksDropped );
+	}
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetIntegerValue( "BlockIDsMissing", Statistics.BlockIDsMissing );
+	}
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetIntegerValue( "ResendGroupRequested", Statistics.ResendGroupRequested );
+	}
+
+	if( lResult.IsOK() )
+	{
+		lResult = cStreamParams->GetIntegerValue( "ResendPacketRequested", Statistics.ResendPacketRequested );
+	}
+
+	if( !lResult.IsOK() )
+	{
+		return AS_GIGE_GET_INTEGER_VALUE_ERROR;
+	}
+
+	{
+		std::lock_guard<std::mutex> lLock( cAttachedBuffersLock );
+		lAttachedCount = cAttachedBuffers.size();
+	}
+
+	if( lAttachedCount )
+	{
+		Statistics.PipelineQueueDepth = lAttachedCount - cStream->GetQueuedBufferCount();
+	}
+	else if( cPipeline && cPipeline->IsStarted() )
+	{
+		Statistics.PipelineQueueDepth = cPipeline->GetOutputQueueSize();
+	}
+	else
+	{
+		Statistics.PipelineQueueDepth = 0;
+	}
+
+	return AS_NO_ERROR;
+}
+
+i32 GigEDevice::GetTimestampTickFrequency( u64 &Frequency )
+{
+	i64 lValue = 0;
+
+	if( cSimulator )
+	{
+		return AS_GIGE_SIMULATED_DEVICE;
+	}
+
+	cResult = cDeviceParams->GetIntegerValue( "GevTimestampTickFrequency", lValue );
+
+	if( !cResult.IsOK() )
+	{
+		return AS_GIGE_GET_INTEGER_VALUE_ERROR;
+	}
+
+	Frequency = (u64)lValue;
+
+	return AS_NO_ERROR;
+}
+
 PvResult GigEDevice::GetLastResult()
 {
 	return cResult;
 }
 
+// statistics of the free transfer buffers since the start of the last AcquireImageThread
+void GigEDevice::GetTransferBufferStatistics( u32 &HighWaterMark, u32 &LowWaterMark, u64 &Underruns )
+{
+	HighWaterMark	= (u32)cAvailableTransferBuffer.HighWaterMark();
+	LowWaterMark	= (u32)cAvailableTransferBuffer.LowWaterMark();
+	Underruns		= cAvailableTransferBuffer.PopFailures();
+}
+
 GigEDevice::GigEDevice(const str8 aDeviceDescriptor)
 {
 	cDeviceInfo					= NULL;
@@ -866,30 +1199,51 @@ GigEDevice::GigEDevice(const str8 aDeviceDescriptor)
 	cStopCmd					= NULL;
 	cResetCmd					= NULL;
 	cTransferBufferFrameCount	= 0;
+	cTransferBufferSize			= 0;
 	cTransferBuffer.clear();
 	cUseTermChar				= 0;
 	cTermChar					= 0;
+	cSimulator					= NULL;
 	cReadyCallBack				= NULL;
 	cFinishCallBack				= NULL;
 	cBufferCallBack				= NULL;
 	cAcquiredImages				= 0;
 	cContinuous					= 0;
 	cStopAcquisition			= 0;
+	cArmed						= 0;
 	cBlocksDroppedVal			= 0;
 	cBlocksDropped				= NULL;
 	cBlockIDsMissingVal			= 0;
 	cBlockIDsMissing			= NULL;
 	cFrameTime					= 0;
 	cFrameTimeOut				= 0;
+	cBufferHandlingThreadPriority	= -1;
 
 	cResult						= PvResult::Code::OK;
+	cSerialResult				= PvResult::Code::OK;
 	cAcqResult					= PvResult::Code::OK;
 
-#ifndef __linux__
-	InitializeCriticalSectionAndSpinCount(&cAvailableTransferBufferLock, 0x0400);
-#endif
 	ClearQueue();
 
+	if( SerialSimulator::IsSimulator( aDeviceDescriptor ) )
+	{
+		// serial port only, everything needing the stream or the GenICam parameters fails
+		cSimulator = new SerialSimulator();
+
+		cDeviceInformation.Vendor	= "Simulator";
+		cDeviceInformation.Model	= "Simulator";
+		cDeviceInformationStr.Vendor			= (str8)cDeviceInformation.Vendor.GetAscii();
+		cDeviceInformationStr.Model				= (str8)cDeviceInformation.Model.GetAscii();
+		cDeviceInformationStr.ManufacturerInfo	= (str8)cDeviceInformation.ManufacturerInfo.GetAscii();
+		cDeviceInformationStr.SerialNumber		= (str8)cDeviceInformation.SerialNumber.GetAscii();
+		cDeviceInformationStr.UserId			= (str8)cDeviceInformation.UserId.GetAscii();
+		cDeviceInformationStr.MacAddress		= (str8)cDeviceInformation.MacAddress.GetAscii();
+		cDeviceInformationStr.IpAddress			= (str8)cDeviceInformation.IpAddress.GetAscii();
+		cDeviceInformationStr.NetMask			= (str8)cDeviceInformation.NetMask.GetAscii();
+		cDeviceInformationStr.GateWay			= (str8)cDeviceInformation.GateWay.GetAscii();
+		return;
+	}
+
 	cResult = Connect( aDeviceDescriptor );
 
 	if( cResult.IsOK() )
@@ -948,18 +1302,37 @@ void GigEDevice::InitializeQueue()
 {
 	for( u32 i=0; i<cTransferBuffer.size() ; i++ )
 	{
-		cAvailableTransferBuffer.push( &cTransferBuffer[i][0] );
+		cAvailableTransferBuffer.Push( cTransferBuffer[i] );
+	}
+}
+
+void GigEDevice::FreeTransferBuffers()
+{
+	for( u32 i=0; i<cTransferBuffer.size() ; i++ )
+	{
+		cTransferBufferAllocator.Free( cTransferBuffer[i], cTransferBufferSize );
+		cTransferBuffer[i] = NULL;
 	}
 }
 
 i32 GigEDevice::OpenSerialPort( PvDeviceSerial SerialPort, u32 RxBufferSize, u8 UseTermChar, u8 TermChar )
 {
+	if( cSimulator )
+	{
+		cUseTermChar = UseTermChar;
+		cTermChar = TermChar;
+		cSimulator->Flush();
+		return AS_NO_ERROR;
+	}
+
+	cSerialResult = PvResult::Code::OK;
+
 	if( cPort.IsOpened() )
 	{
-		cResult = cPort.Close();
+		cSerialResult = cPort.Close();
 	}
 	
-	if( !cResult.IsOK() )
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_CLOSE_ERROR;
 	}
@@ -971,28 +1344,28 @@ i32 GigEDevice::OpenSerialPort( PvDeviceSerial SerialPort, u32 RxBufferSize, u8
 
 	if( (SerialPort == PvDeviceSerial0) || (SerialPort == PvDeviceSerial1) )
 	{
-		cResult = ConfigureSerialUart( SerialPort );
+		cSerialResult = ConfigureSerialUart( SerialPort );
 	}
 	else if( (SerialPort >= PvDeviceSerialBulk0) && (SerialPort <= PvDeviceSerialBulk7) )
 	{
-		cResult = ConfigureSerialBulk( SerialPort );
+		cSerialResult = ConfigureSerialBulk( SerialPort );
 	}
 
-	if( !cResult.IsOK() )
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_CONFIG_FAILED;
 	}
 
-	cResult = cPort.SetRxBufferSize( RxBufferSize );
+	cSerialResult = cPort.SetRxBufferSize( RxBufferSize );
 
-	if( !cResult.IsOK() )
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_SET_RX_BUFFER_FAILED;
 	}
 
-	cResult = cPort.Open( cDeviceAdapter, SerialPort );
+	cSerialResult = cPort.Open( cDeviceAdapter, SerialPort );
 
-	if( !cResult.IsOK() )
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_OPEN_ERROR;
 	}
@@ -1005,6 +1378,11 @@ i32 GigEDevice::OpenSerialPort( PvDeviceSerial SerialPort, u32 RxBufferSize, u8
 
 i32 GigEDevice::OpenStream( bool TimeoutCountedAsError, bool AbortCountedAsError )
 {
+	if( cSimulator )
+	{
+		return AS_GIGE_SIMULATED_DEVICE;
+	}
+
 	if( !cStream )
 	{
 		cStream = PvStream::CreateAndOpen( cDeviceInfo->GetConnectionID(), &cResult );
@@ -1044,9 +1422,9 @@ i32	GigEDevice::ReadSerialPort( p_u8 RxBuffer, u32 RxBufferSize, u32 *BytesRead,
 
 		while ( *BytesRead < RxBufferSize )
 		{
-			cResult = cPort.Read( RxBuffer + *BytesRead, RxBufferSize - *BytesRead, lBytesRead, TimeOut );
+			cSerialResult = SerialRead( RxBuffer + *BytesRead, RxBufferSize - *BytesRead, lBytesRead, TimeOut );
 
-			if( !cResult.IsOK() )
+			if( !cSerialResult.IsOK() )
 			{
 				return AS_GIGE_SERIAL_PORT_READ_ERROR;
 			}
@@ -1063,11 +1441,11 @@ i32	GigEDevice::ReadSerialPort( p_u8 RxBuffer, u32 RxBufferSize, u32 *BytesRead,
 	}
 	else
 	{
-		cResult = cPort.Read( RxBuffer, RxBufferSize, lBytesRead, TimeOut );
+		cSerialResult = SerialRead( RxBuffer, RxBufferSize, lBytesRead, TimeOut );
 
 		*BytesRead = lBytesRead;
 
-		if( !cResult.IsOK() )
+		if( !cSerialResult.IsOK() )
 		{
 			return AS_GIGE_SERIAL_PORT_READ_ERROR;
 		}
@@ -1095,15 +1473,35 @@ void GigEDevice::RegisterTransferBufferReadyCallBack( p_bufferCallBack aTransfer
 
 void GigEDevice::ReturnBuffer( p_u8 Buffer )
 {
-#ifdef __linux__
-    cAvailableTransferBufferLock.lock();
-	cAvailableTransferBuffer.push(Buffer);
-    cAvailableTransferBufferLock.unlock();
-#else
-	EnterCriticalSection( &cAvailableTransferBufferLock );
-	cAvailableTransferBuffer.push(Buffer);
-	LeaveCriticalSection( &cAvailableTransferBufferLock );
-#endif
+	// only one thread may return buffers while AcquireImageThread is running
+	cAvailableTransferBuffer.Push( Buffer );
+}
+
+/**
+ * The buffer handling thread is created by the pipeline at start and inherits the
+ * affinity of the starting thread, see StartPipeline. An empty list keeps the
+ * affinity of the caller.
+ */
+void GigEDevice::SetBufferHandlingThreadAffinity( const std::vector<int> &Cpus )
+{
+	cBufferHandlingThreadCpus = Cpus;
+}
+
+i32 GigEDevice::SetBufferHandlingThreadPriority( i32 Priority )
+{
+	cBufferHandlingThreadPriority = Priority;
+
+	if( cPipeline && ( Priority >= 0 ) )
+	{
+		cResult = cPipeline->SetBufferHandlingThreadPriority( Priority );
+
+		if( !cResult.IsOK() )
+		{
+			return AS_GIGE_SET_THREAD_PRIORITY_ERROR;
+		}
+	}
+
+	return AS_NO_ERROR;
 }
 
 void GigEDevice::SetFrameTime( dbl FrameTime )
@@ -1125,6 +1523,11 @@ void GigEDevice::SetFrameTimeOut( u32 FrameTimeOut )
 
 i32	GigEDevice::SetImageFormatControl( const str8 PixelFormat, u64 Width, u64 Height, u64 OffsetX, u64 OffsetY, const str8 SensorTaps, const str8 TestPattern )
 {
+	if( cSimulator )
+	{
+		return AS_GIGE_SIMULATED_DEVICE;
+	}
+
 	cResult = cDeviceParams->SetEnumValue( "PixelFormat", PixelFormat );
 
 	if( cResult.IsOK() )
@@ -1167,8 +1570,65 @@ i32	GigEDevice::SetImageFormatControl( const str8 PixelFormat, u64 Width, u64 He
 
 void GigEDevice::SetTransferBuffer( u32 TransferBufferCount, u32 TransferBufferFrameCount )
 {
+	if( TransferBufferCount < cTransferBuffer.size() )
+	{
+		FreeTransferBuffers();
+	}
 	cTransferBufferFrameCount = TransferBufferFrameCount;
-	cTransferBuffer.resize( TransferBufferCount );
+	cTransferBuffer.resize( TransferBufferCount, NULL );
+	cAvailableTransferBuffer.Resize( TransferBufferCount );
+}
+
+// takes effect for the transfer buffers allocated by the next CreatePipeline
+void GigEDevice::SetBufferAllocation( u32 Flags, i32 NumaNode )
+{
+	if( ( Flags != cTransferBufferAllocator.GetFlags() ) || ( NumaNode != cTransferBufferAllocator.GetNumaNode() ) )
+	{
+		FreeTransferBuffers();
+		cTransferBufferAllocator.SetMode( Flags, NumaNode );
+	}
+}
+
+// flags achieved by the last transfer buffer allocation
+u32 GigEDevice::GetBufferAllocation()
+{
+	return cTransferBufferAllocator.GetAchieved();
+}
+
+PvResult GigEDevice::StartPipeline()
+{
+	PvResult	lResult;
+#ifdef __linux__
+	cpu_set_t	lCallerCpus;
+	cpu_set_t	lCpus;
+	bool		lSwapAffinity = false;
+
+	if( cBufferHandlingThreadCpus.size() )
+	{
+		lSwapAffinity = ( pthread_getaffinity_np( pthread_self(), sizeof( lCallerCpus ), &lCallerCpus ) == 0 );
+	}
+
+	if( lSwapAffinity )
+	{
+		CPU_ZERO( &lCpus );
+		for( u32 i=0 ; i<cBufferHandlingThreadCpus.size() ; i++ )
+		{
+			CPU_SET( cBufferHandlingThreadCpus[i], &lCpus );
+		}
+		pthread_setaffinity_np( pthread_self(), sizeof( lCpus ), &lCpus );
+	}
+#endif
+
+	lResult = cPipeline->Start();
+
+#ifdef __linux__
+	if( lSwapAffinity )
+	{
+		pthread_setaffinity_np( pthread_self(), sizeof( lCallerCpus ), &lCallerCpus );
+	}
+#endif
+
+	return lResult;
 }
 
 void GigEDevice::StopAcquisition()
@@ -1176,15 +1636,78 @@ void GigEDevice::StopAcquisition()
 	cStopAcquisition = 1;
 }
 
+/**
+ * Waits for the next buffer of the pipeline, or of the stream when buffers are attached,
+ * in slices of about one frame time so that StopAcquisition is noticed within one slice
+ * instead of one full TimeOut. Returns ABORTED when stopped.
+ */
+PvResult GigEDevice::RetrieveNextBuffer( PvBuffer **Buffer, u32 TimeOut, PvResult *OperationResult )
+{
+	PvResult	lResult = PvResult::Code::TIMEOUT;
+	u32			lSlice = (u32)ceil( cFrameTime * 1000 );
+	u32			lWaited = 0;
+
+	if( lSlice < AS_HEXITEC_MIN_FRAME_TIMEOUT )
+	{
+		lSlice = AS_HEXITEC_MIN_FRAME_TIMEOUT;
+	}
+
+	do
+	{
+		if( cStopAcquisition )
+		{
+			return PvResult::Code::ABORTED;
+		}
+		if( lSlice > TimeOut - lWaited )
+		{
+			lSlice = TimeOut - lWaited;
+		}
+		if( cAttachedBuffers.size() )
+		{
+			lResult = cStream->RetrieveBuffer( Buffer, OperationResult, lSlice );
+		}
+		else
+		{
+			lResult = cPipeline->RetrieveNextBuffer( Buffer, lSlice, OperationResult );
+		}
+		if( lResult != PvResult::Code::TIMEOUT )
+		{
+			break;
+		}
+		lWaited += lSlice;
+	}
+	while( lWaited < TimeOut );
+
+	return lResult;
+}
+
+PvResult GigEDevice::SerialRead( p_u8 RxBuffer, u32 RxBufferSize, u32 &BytesRead, u32 TimeOut )
+{
+	if( cSimulator )
+	{
+		return cSimulator->Read( RxBuffer, RxBufferSize, &BytesRead, TimeOut ) ? PvResult::Code::OK : PvResult::Code::TIMEOUT;
+	}
+
+	return cPort.Read( RxBuffer, RxBufferSize, BytesRead, TimeOut );
+}
+
 i32	GigEDevice::WriteSerialPort( const p_u8 TxBuffer, u32 TxBufferSize, u32 *BytesWritten )
 {
 	u32 lBytesWritten = 0;
 
-	cResult = cPort.Write( TxBuffer, TxBufferSize, lBytesWritten );
+	if( cSimulator )
+	{
+		cSimulator->Write( TxBuffer, TxBufferSize, &lBytesWritten );
+		cSerialResult = PvResult::Code::OK;
+	}
+	else
+	{
+		cSerialResult = cPort.Write( TxBuffer, TxBufferSize, lBytesWritten );
+	}
 
 	*BytesWritten = lBytesWritten;
 
-	if( !cResult.IsOK() )
+	if( !cSerialResult.IsOK() )
 	{
 		return AS_GIGE_SERIAL_PORT_WRITE_ERROR;
 	}
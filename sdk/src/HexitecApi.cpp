@@ -3,9 +3,10 @@
 #ifndef COMPILE_HEXITEC_DUMMY
 
 #include "INIReader.h"
-#include <iomanip>
-#include <sstream>
+#include <HexCodec.h>
 #include <iostream>
+#include <algorithm>
+#include <iterator>
 #include <cmath>
 #include <unistd.h>
 #include <chrono>
@@ -16,10 +17,12 @@ using namespace HexitecAPI;
 using namespace GigE;
 
 HexitecApi::HexitecApi(const std::string deviceDescriptor, uint32_t timeout) : m_deviceDescriptor(deviceDescriptor), m_timeout(timeout),
-	m_sensorConfig(), m_operationMode(), m_systemConfig(), m_biasConfig() {
+	m_sensorConfig(), m_operationMode(), m_systemConfig(), m_biasConfig(), m_serialRunning(false), m_coherenceCheck(false), m_configurationHash(0) {
+	m_serialDeadline.fill(0);
 }
 
 HexitecApi::~HexitecApi() {
+	stopSerialWorker();
 	delete gigeDevice;
 }
 
@@ -40,6 +43,12 @@ int32_t HexitecApi::readConfiguration(std::string fname) {
 	if (reader.ParseError() < 0) {
 		return OPENFILE_ERR;
 	}
+	// FNV-1a of the file, identifies the configuration a detector was set up with
+	std::ifstream file(fname, std::ios::binary);
+	m_configurationHash = 0xcbf29ce484222325ULL;
+	for (std::istreambuf_iterator<char> it(file), end; it != end; ++it) {
+		m_configurationHash = (m_configurationHash ^ (uint8_t) *it) * 0x100000001b3ULL;
+	}
 	section = "HexitecSystemConfig";
 	m_systemConfig.AdcDelay = reader.GetInteger(section, "ADC1 Delay", -1);
 	m_systemConfig.SyncSignalDelay = reader.GetInteger(section, "Delay sync signals", -1);
@@ -155,6 +164,7 @@ int32_t HexitecApi::setTriggerCountingMode(bool enable) {
 }
 
 int32_t HexitecApi::createPipelineOnly(uint32_t bufferCount) {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	return gigeDevice->CreatePipeline(bufferCount);
 }
 
@@ -166,6 +176,20 @@ int32_t HexitecApi::getFramesAcquired() {
 	return gigeDevice->GetAcquiredImageCount();
 }
 
+/**
+ * Prepares the stream so that a following startAcq only has to send the start command.
+ */
+int32_t HexitecApi::armAcq() {
+	return gigeDevice->armAcq();
+}
+
+/**
+ * Releases an armed stream that is not going to be started.
+ */
+int32_t HexitecApi::disarmAcq() {
+	return gigeDevice->disarmAcq();
+}
+
 int32_t HexitecApi::startAcq() {
 	return gigeDevice->startAcq();
 }
@@ -177,10 +201,13 @@ int32_t HexitecApi::stopAcq() {
 int32_t HexitecApi::setHvBiasOn(bool onOff) {
 	int32_t result;
 	if (onOff) {
-		result = setDAC(m_sensorConfig.Vcal, m_systemConfig.Umid, m_biasConfig.BiasVoltage, m_systemConfig.DetCtrl, m_systemConfig.TargetTemperature);
+		result = setDAC(m_sensorConfig.Vcal, m_systemConfig.Umid, m_biasConfig.BiasVoltage, m_systemConfig.DetCtrl, m_systemConfig.TargetTemperature,
+				SERIAL_PRIORITY_CONTROL);
 	} else {
-		result = setDAC(m_sensorConfig.Vcal, m_systemConfig.Umid, m_biasConfig.RefreshVoltage, m_systemConfig.DetCtrl, m_systemConfig.TargetTemperature);
+		result = setDAC(m_sensorConfig.Vcal, m_systemConfig.Umid, m_biasConfig.RefreshVoltage, m_systemConfig.DetCtrl, m_systemConfig.TargetTemperature,
+				SERIAL_PRIORITY_CONTROL);
 	}
+	return result;
 }
 
 void HexitecApi::setBiasVoltage(int volts) {
@@ -202,10 +229,67 @@ void HexitecApi::getRefreshVoltage(int& volts) {
  * @param [IN] frametimeout time in milliseconds to wait for frame to complete
  */
 int32_t HexitecApi::retrieveBuffer(uint8_t* buffer, uint32_t frametimeout) {
-	int32_t rc = gigeDevice->retrieveBuffer(buffer, frametimeout);
+	HexitecFrameInfo frameInfo;
+	return retrieveBuffer(buffer, frametimeout, frameInfo);
+}
+
+/**
+ * @param [IN] frametimeout time in milliseconds to wait for frame to complete
+ * @param [OUT] frameInfo block ID and device timestamp of the frame
+ */
+int32_t HexitecApi::retrieveBuffer(uint8_t* buffer, uint32_t frametimeout, HexitecFrameInfo& frameInfo) {
+	int32_t rc = gigeDevice->retrieveBuffer(buffer, frametimeout, frameInfo.BlockId, frameInfo.Timestamp);
+	return rc;
+}
+
+/**
+ * Zero copy retrieve into one of the buffers given to attachBuffers
+ * @param [OUT] bufferIndex index of the attached buffer holding the frame
+ * @param [IN] frametimeout time in milliseconds to wait for frame to complete
+ * @param [OUT] frameInfo block ID and device timestamp of the frame
+ */
+int32_t HexitecApi::retrieveBuffer(uint32_t& bufferIndex, uint32_t frametimeout, HexitecFrameInfo& frameInfo) {
+	return gigeDevice->retrieveBuffer(bufferIndex, frametimeout, frameInfo.BlockId, frameInfo.Timestamp);
+}
+
+int32_t HexitecApi::requeueBuffer(uint32_t bufferIndex) {
+	return gigeDevice->requeueBuffer(bufferIndex);
+}
+
+/**
+ * Zero copy: takes all attached buffers back from the stream, to be handed back with requeueBuffers
+ * @param [OUT] bufferIndices attached buffers holding frames completed but not retrieved yet, in order
+ * @param [OUT] frameInfo block ID and device timestamp of each of those frames
+ */
+int32_t HexitecApi::reclaimBuffers(std::vector<uint32_t>& bufferIndices, std::vector<HexitecFrameInfo>& frameInfo) {
+	std::vector<uint64_t> blockIds;
+	std::vector<uint64_t> timestamps;
+	int32_t rc = gigeDevice->reclaimBuffers(bufferIndices, blockIds, timestamps);
+	frameInfo.resize(bufferIndices.size());
+	for (size_t i = 0; i < bufferIndices.size(); i++) {
+		frameInfo[i].BlockId = blockIds[i];
+		frameInfo[i].Timestamp = timestamps[i];
+	}
 	return rc;
 }
 
+/**
+ * Zero copy: queues all attached buffers again
+ * @param [IN] firstIndex index of the buffer the stream fills next, the others follow in order
+ */
+int32_t HexitecApi::requeueBuffers(uint32_t firstIndex) {
+	return gigeDevice->requeueBuffers(firstIndex);
+}
+
+int32_t HexitecApi::attachBuffers(std::vector<uint8_t*>& buffers, uint32_t bufferSize) {
+	return gigeDevice->AttachBuffers(buffers.data(), buffers.size(), bufferSize);
+}
+
+int32_t HexitecApi::detachBuffers() {
+	gigeDevice->DetachBuffers();
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::openSerialPortBulk0(uint32_t rxBufferSize, uint8_t useTermChar, uint8_t termChar) {
 	return gigeDevice->OpenSerialPort(PvDeviceSerialBulk0, rxBufferSize, useTermChar, termChar);
 }
@@ -237,6 +321,7 @@ int32_t HexitecApi::checkFirmware(uint8_t& customerId, uint8_t& projectId, uint8
 }
 
 int32_t HexitecApi::closePipeline() {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	return gigeDevice->ClosePipeline();
 }
 
@@ -245,6 +330,7 @@ int32_t HexitecApi::closeSerialPort() {
 }
 
 int32_t HexitecApi::closeStream() {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	return gigeDevice->CloseStream();
 }
 
@@ -296,23 +382,11 @@ int32_t HexitecApi::configureDetector(uint8_t& width, uint8_t& height, double& f
 		}
 	}
 	if (result == NO_ERROR) {
-		value = 0x01;
-		result = writeRegister(0x07, value);
-	}
-	if (result == NO_ERROR) {
-		value = m_systemConfig.AdcDelay;
-		result = writeRegister(0x09, value);
-	}
-	if (result == NO_ERROR) {
-		value = m_systemConfig.SyncSignalDelay;
-		result = writeRegister(0x0e, value);
-	}
-	if (result == NO_ERROR) {
-		value = m_systemConfig.AdcSample;
-		result = writeRegister(0x14, value);
-	}
-	if (result == NO_ERROR) {
-		result = setSensorConfig(m_sensorConfig);
+		// system and sensor configuration in as few serial round trips as possible
+		FpgaRegisterVector registers;
+		systemConfigRegisters(registers);
+		sensorConfigRegisters(m_sensorConfig, registers);
+		result = writeRegisters(registers);
 	}
 	if (result == NO_ERROR) {
 		result = setOperationMode(m_operationMode);
@@ -334,91 +408,189 @@ int32_t HexitecApi::configureDetector(uint8_t& width, uint8_t& height, double& f
 		result = writeAdcRegister(0x16, value);
 	}
 	if (result == NO_ERROR) {
-		result = readResolution(width, height);
+		result = readFrameTiming(width, height, frameTime, collectDcTime);
 	}
+	if ((result == NO_ERROR) && (m_operationMode.enSyncMode))
+	{
+		result = enableSyncMode();
+	}
+	return result;
+}
+
+/**
+ * Picks up a detector that is still configured from an earlier session: reads the
+ * resolution and sets the frame timing. The registers changed at run time are not
+ * verified, so the sync mode and operation mode are written from the configuration
+ * and the trigger mode and gate are cleared, as the camera starts in internal trigger.
+ */
+int32_t HexitecApi::resumeConfiguration(uint8_t& width, uint8_t& height, double& frameTime, uint32_t& collectDcTime) {
+	int32_t result = NO_ERROR;
+
+	if (m_operationMode.enSyncMode == CONTROL_ENABLED) {
+		result = enableSyncMode();
+	} else {
+		result = disableSyncMode();
+	}
+	if (result == NO_ERROR) {
+		result = disableTriggerGate();
+	}
+	if (result == NO_ERROR) {
+		result = disableTriggerMode();
+	}
+	if (result == NO_ERROR) {
+		result = setOperationMode(m_operationMode);
+	}
+	if (result == NO_ERROR) {
+		result = readFrameTiming(width, height, frameTime, collectDcTime);
+	}
+	return result;
+}
+
+// reads the resolution and sets the frame timing that follows from it
+int32_t HexitecApi::readFrameTiming(uint8_t& width, uint8_t& height, double& frameTime, uint32_t& collectDcTime) {
+	int32_t result = readResolution(width, height);
+
 	if (result == NO_ERROR) {
 		frameTime = getFrameTime(width, height);
 		collectDcTime = getCollectDcTime(frameTime);
 		gigeDevice->SetFrameTime(frameTime);
 		gigeDevice->SetFrameTimeOut((u32)((frameTime*1000*HEXITEC_FRAME_TIMEOUT_MULTIPLIER)+1));
 	}
-	if ((result == NO_ERROR) && (m_operationMode.enSyncMode))
-	{
-		result = enableSyncMode();
+	return result;
+}
+
+/**
+ * Reads back a sample of the registers configureDetector writes: the state machine
+ * enable, the system configuration, gain, wait clocks and both ends of the setup
+ * registers. A power cycled detector or one configured from other settings fails.
+ * The sync, trigger and operation mode registers change at run time and are left to
+ * resumeConfiguration.
+ * @param [OUT] configured true when all of them hold the values of the loaded configuration
+ */
+int32_t HexitecApi::verifyConfiguration(bool& configured) {
+	const uint8_t lastSetupRegister = HEXITEC_SETUP_REGISTER_START_ADDRESS + 6 * HEXITEC_SETUP_REGISTER_SIZE - 1;
+	FpgaRegisterVector registers = {{0x01, CONTROL_ENABLED}};
+	FpgaRegisterVector sensorRegisters;
+	int32_t result = NO_ERROR;
+
+	systemConfigRegisters(registers);
+	sensorConfigRegisters(m_sensorConfig, sensorRegisters);
+	for (auto& reg : sensorRegisters) {
+		if ((reg.address == 0x06) || (reg.address == 0x1a) || (reg.address == 0x1b)
+				|| (reg.address == HEXITEC_SETUP_REGISTER_START_ADDRESS) || (reg.address == lastSetupRegister)) {
+			registers.push_back(reg);
+		}
+	}
+	configured = true;
+	for (auto& reg : registers) {
+		uint8_t value = 0;
+		result = readDeviceRegister(reg.address, value);
+		if (result != NO_ERROR) {
+			configured = false;
+			break;
+		}
+		shadowRegister(reg.address, value, true);
+		if (value != reg.value) {
+			configured = false;
+			break;
+		}
 	}
 	return result;
 }
 
+/**
+ * @return hash of the configuration file last read by readConfiguration
+ */
+uint64_t HexitecApi::getConfigurationHash() {
+	return m_configurationHash;
+}
+
 void HexitecApi::copyBuffer(uint8_t* sourceBuffer, uint8_t* destBuffer, uint32_t byteCount) {
 	memcpy(destBuffer, sourceBuffer, byteCount);
 }
 
 int32_t HexitecApi::createPipeline(uint32_t bufferCount, uint32_t transferBufferCount, uint32_t transferBufferFrameCount) {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	gigeDevice->SetTransferBuffer(transferBufferCount, transferBufferFrameCount);
 	return gigeDevice->CreatePipeline(bufferCount);
 }
 
 int32_t HexitecApi::createPipelineOld(u32 bufferCount) {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	return  gigeDevice->CreatePipeline( bufferCount );
 }
 
+/**
+ * Frames acquired with acquireFrames are delivered in batches of transferBufferFrameCount
+ * to the callback instead of being queued for a later returnBuffer.
+ */
+void HexitecApi::registerTransferBufferCallback(std::shared_ptr<TransferBufferCallback> cbk) {
+	m_transferBufferCb = cbk;
+	std::shared_ptr<TransferBufferReadyCallback> gigeCbk;
+	if (cbk) {
+		gigeCbk = std::shared_ptr<TransferBufferReadyCallback>(new HexitecBufferReadyCb(*this));
+	}
+	gigeDevice->RegisterTransferBufferReadyCallBack(gigeCbk);
+}
+
+/**
+ * @param [OUT] highWaterMark most free transfer buffers queued during the last acquireFrames
+ * @param [OUT] lowWaterMark fewest free transfer buffers left, 0 if the acquisition loop ran dry
+ * @param [OUT] underruns number of times no free transfer buffer was available
+ */
+int32_t HexitecApi::getTransferBufferStatistics(uint32_t& highWaterMark, uint32_t& lowWaterMark, uint64_t& underruns) {
+	gigeDevice->GetTransferBufferStatistics(highWaterMark, lowWaterMark, underruns);
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::disableSM() {
 	uint8_t value = CONTROL_DISABLED;
 	return writeRegister(0x01, value);
 }
 
 int32_t HexitecApi::disableSyncMode() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x43, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x01, 1), hexDigit(0x01, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x43;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x31;
-	txBuffer[7] = 0x0d;
-	return serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	int32_t result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
+	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x01, false);
+	}
+	return result;
 }
 
 int32_t HexitecApi::disableTriggerGate() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x43, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x04, 1), hexDigit(0x04, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
     int32_t result = NO_ERROR;
     HexitecOperationMode currentMode;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x43;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x34;
-	txBuffer[7] = 0x0d;
-	return serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
+	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x04, false);
+	}
+	return result;
 }
 
 int32_t HexitecApi::disableTriggerMode() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x43, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x02, 1), hexDigit(0x02, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
 	int32_t result = NO_ERROR;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x43;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x32;
-	txBuffer[7] = 0x0d;
-	return serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
+	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x02, false);
+	}
+	return result;
 }
 
 int32_t HexitecApi::enableFunctionBlocks(Control adcEnable, Control dacEnable, Control peltierEnable) {
@@ -443,58 +615,45 @@ int32_t HexitecApi::enableSM() {
 }
 
 int32_t HexitecApi::enableSyncMode() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x42, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x01, 1), hexDigit(0x01, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x42;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x31;
-	txBuffer[7] = 0x0d;
-	return serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	int32_t result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
+	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x01, true);
+	}
+	return result;
 }
 
 int32_t HexitecApi::enableTriggerGate() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x42, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x04, 1), hexDigit(0x04, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
     int32_t result = NO_ERROR;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x42;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x34;
-	txBuffer[7] = 0x0d;
-	result=  serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result=  serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
+	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x04, true);
+	}
     return result;
 }
 
 int32_t HexitecApi::enableTriggerMode() {
-	uint8_t txBuffer[8];
+	static constexpr uint8_t txBuffer[] = {0x23, MODULE_ADDRESS, 0x42, hexDigit(0x0a, 1), hexDigit(0x0a, 0),
+			hexDigit(0x02, 1), hexDigit(0x02, 0), 0x0d};
 	uint8_t rxBuffer[7];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
 	int32_t	result = NO_ERROR;
 
-	txBuffer[0] = 0x23;
-	txBuffer[1] = MODULE_ADDRESS;
-	txBuffer[2] = 0x42;
-	txBuffer[3] = 0x30;
-	txBuffer[4] = 0x41;
-	txBuffer[5] = 0x30;
-	txBuffer[6] = 0x32;
-	txBuffer[7] = 0x0d;
-	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_CONTROL);
 	if (result == NO_ERROR) {
+		shadowRegisterBits(0x0a, 0x02, true);
 		std::shared_ptr<AcqArmedCallback> cbk = std::shared_ptr<AcqArmedCallback>(new HexitecApi::HexitecArmedCb(*this));
 		gigeDevice->RegisterAcqArmedCallBack(cbk);
 	}
@@ -510,7 +669,10 @@ void armed() {
 }
 
 int32_t HexitecApi::exitDevice() {
+	stopSerialWorker();
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	delete gigeDevice;
+	gigeDevice = NULL;
 	return NO_ERROR;
 }
 
@@ -541,6 +703,35 @@ int32_t HexitecApi::getBufferHandlingThreadPriority(int32_t& priority )
 	return NO_ERROR;
 }
 
+int32_t HexitecApi::setBufferHandlingThreadPriority(int32_t priority) {
+	return gigeDevice->SetBufferHandlingThreadPriority(priority);
+}
+
+/**
+ * @param [IN] cpus cores the pipeline buffer handling thread is pinned to at the next start, empty for no pinning
+ */
+int32_t HexitecApi::setBufferHandlingThreadAffinity(const std::vector<int>& cpus) {
+	gigeDevice->SetBufferHandlingThreadAffinity(cpus);
+	return NO_ERROR;
+}
+
+/**
+ * @param [IN] flags GigE::BufferAllocationFlags for the transfer buffers created by the next createPipeline
+ * @param [IN] numaNode node the buffers are bound to with GigE::BUFFER_ALLOCATION_NUMA
+ */
+int32_t HexitecApi::setBufferAllocation(uint32_t flags, int32_t numaNode) {
+	gigeDevice->SetBufferAllocation(flags, numaNode);
+	return NO_ERROR;
+}
+
+/**
+ * @param [OUT] achieved GigE::BufferAllocationFlags the transfer buffers actually got
+ */
+int32_t HexitecApi::getBufferAllocation(uint32_t& achieved) {
+	achieved = gigeDevice->GetBufferAllocation();
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::getDeviceInformation(HexitecDeviceInfo& deviceInfo) {
 	GigEDeviceInfoStr deviceInfoStr = gigeDevice->GetDeviceInfoStr();
 	deviceInfo.Vendor = deviceInfoStr.Vendor;
@@ -568,6 +759,42 @@ int32_t HexitecApi::getIntegerValue(const std::string propertyName, int64_t& val
 	return gigeDevice->GetIntegerValue(const_cast<char*>(propertyName.c_str()), value);
 }
 
+int32_t HexitecApi::getTimestampTickFrequency(uint64_t& frequency) {
+	return gigeDevice->GetTimestampTickFrequency(frequency);
+}
+
+int32_t HexitecApi::getStreamStatistics(HexitecStreamStatistics& statistics) {
+	GigEStreamStatistics gigeStatistics;
+	// sampled from a thread of its own, the stream and pipeline must not be replaced meanwhile
+	std::lock_guard<std::mutex> lock(m_streamMutex);
+	int32_t result = gigeDevice->GetStreamStatistics(gigeStatistics);
+	if (result == NO_ERROR) {
+		statistics.Bandwidth = gigeStatistics.Bandwidth / 1000000.0;
+		statistics.AcquisitionRate = gigeStatistics.AcquisitionRate;
+		statistics.BlockCount = gigeStatistics.BlockCount;
+		statistics.BlocksDropped = gigeStatistics.BlocksDropped;
+		statistics.BlockIDsMissing = gigeStatistics.BlockIDsMissing;
+		statistics.ResendGroupRequested = gigeStatistics.ResendGroupRequested;
+		statistics.ResendPacketRequested = gigeStatistics.ResendPacketRequested;
+		statistics.PipelineQueueDepth = gigeStatistics.PipelineQueueDepth;
+	}
+	return result;
+}
+
+/**
+ * @return number of frames lost between two consecutive block IDs
+ */
+uint64_t HexitecApi::blockIdGap(uint64_t previous, uint64_t current) {
+	return GigE::BlockIdGap(previous, current);
+}
+
+/**
+ * @return true when the block IDs stepped backwards without wrapping
+ */
+bool HexitecApi::blockIdRestarted(uint64_t previous, uint64_t current) {
+	return GigE::BlockIdRestarted(previous, current);
+}
+
 int32_t HexitecApi::getLastResult(uint32_t& internalErrorCode, std::string errorCodeString, std::string errorDescription) {
 	int32_t result = NO_ERROR;
 	PvResult pvResult = PvResult::Code::OK;
@@ -742,7 +969,13 @@ int32_t HexitecApi::initDevice(uint32_t& internalErrorCode, std::string& errorCo
 	char pleoraErrorDescription[255];
 	uint32_t pleoraErrorDescriptionLen = 255;
 
-	gigeDevice = new GigEDevice(const_cast<char*>(m_deviceDescriptor.c_str()));
+	clearRegisterShadow();
+	stopSerialWorker();
+	{
+		std::lock_guard<std::mutex> lock(m_streamMutex);
+		gigeDevice = new GigEDevice(const_cast<char*>(m_deviceDescriptor.c_str()));
+	}
+	startSerialWorker();
 	pvResult = gigeDevice->GetLastResult();
 	internalErrorCode = pvResult.GetCode();
 	gigeDevice->GetErrorDescription(pvResult, pleoraErrorCodeString, &pleoraErrorCodeStringLen, pleoraErrorDescription,
@@ -795,6 +1028,7 @@ int32_t HexitecApi::initFwDefaults(uint8_t setHv, double& hvSetPoint, uint8_t& w
 }
 
 int32_t HexitecApi::openStream() {
+	std::lock_guard<std::mutex> lock(m_streamMutex);
 	return gigeDevice->OpenStream(true, true);
 }
 
@@ -810,7 +1044,7 @@ int32_t HexitecApi::readEnvironmentValues(double& humidity, double& ambientTempe
 	txBuffer[1] = MODULE_ADDRESS;
 	txBuffer[2] = 0x52;
 	txBuffer[3] = 0x0d;
-	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_TELEMETRY);
 
 	ambientTemperature = getAmbientTemperature((uint16_t) stringToHex(&rxBuffer[2], 4));
 	humidity = getHumidity((uint16_t) stringToHex(&rxBuffer[6], 4));
@@ -834,7 +1068,7 @@ int32_t HexitecApi::readOperatingValues(double& v3_3, double& hvMon, double& hvO
 	txBuffer[1] = MODULE_ADDRESS;
 	txBuffer[2] = 0x50;
 	txBuffer[3] = 0x0d;
-	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, SERIAL_PRIORITY_TELEMETRY);
 
 	v3_3 = getInternalReference((uint16_t) stringToHex(&rxBuffer[38], 4));
 	hvMon = getVoltage(stringToHex(&rxBuffer[2], 4), v3_3);
@@ -853,7 +1087,31 @@ int32_t HexitecApi::readOperatingValues(double& v3_3, double& hvMon, double& hvO
 	return result;
 }
 
+/**
+ * Configuration registers are served from the shadow once known. With the coherence check
+ * enabled they are read from the device anyway and REGISTER_COHERENCE_ERROR is returned if
+ * the shadow was stale; value and shadow then hold the device value.
+ */
 int32_t HexitecApi::readRegister(uint8_t registerAddress, uint8_t& value) {
+	int32_t result = NO_ERROR;
+	uint8_t shadow = 0;
+	bool shadowed = shadowedRegister(registerAddress, shadow);
+
+	if (shadowed && !m_coherenceCheck) {
+		value = shadow;
+		return NO_ERROR;
+	}
+	result = readDeviceRegister(registerAddress, value);
+	if (result == NO_ERROR) {
+		if (shadowed && shadow != value) {
+			result = REGISTER_COHERENCE_ERROR;
+		}
+		shadowRegister(registerAddress, value, true);
+	}
+	return result;
+}
+
+int32_t HexitecApi::readDeviceRegister(uint8_t registerAddress, uint8_t& value) {
 	uint8_t txBuffer[6];
 	uint8_t rxBuffer[128];
 	uint32_t bytesWritten = 0;
@@ -887,31 +1145,155 @@ int32_t HexitecApi::returnBuffer(uint8_t* transferBuffer) {
 }
 
 int32_t HexitecApi::serialPortWriteRead(const uint8_t* txBuffer, uint32_t txBufferSize, uint32_t& bytesWritten, uint8_t* rxBuffer,
-		uint32_t rxBufferSize, uint32_t& bytesRead) {
-	int32_t result = NO_ERROR;
+		uint32_t rxBufferSize, uint32_t& bytesRead, SerialPriority priority) {
+	std::shared_ptr<SerialCommand> command = std::make_shared<SerialCommand>();
+
+	command->txBuffer = txBuffer;
+	command->txBufferSize = txBufferSize;
+	command->bytesWritten = 0;
+	command->rxBuffer = rxBuffer;
+	command->rxBufferSize = rxBufferSize;
+	command->bytesRead = 0;
+	if (m_serialDeadline[priority]) {
+		command->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_serialDeadline[priority]);
+	}
+	int32_t result = queueSerialCommand(command, priority).get();
+	bytesWritten = command->bytesWritten;
+	bytesRead = command->bytesRead;
+	return result;
+}
 
-	mutexLock.lock();
-	if (txBufferSize) {
-		result = gigeDevice->FlushRxBuffer();
-		if (result == NO_ERROR) {
-			result = gigeDevice->WriteSerialPort(const_cast<uint8_t*>(txBuffer), txBufferSize, &bytesWritten);
-		}
+/**
+ * Queues a transaction for the serial worker, the future yields its result code.
+ * Fails with SERIAL_DEADLINE_ERROR when the command waited past its deadline and with
+ * SERIAL_QUEUE_CLOSED_ERROR when the device is not open.
+ */
+std::future<int32_t> HexitecApi::queueSerialCommand(std::shared_ptr<SerialCommand> command, SerialPriority priority) {
+	std::future<int32_t> future = command->result.get_future();
+	std::unique_lock<std::mutex> lock(mutexLock);
+
+	if (!m_serialRunning || (priority >= SERIAL_PRIORITY_COUNT)) {
+		command->result.set_value(SERIAL_QUEUE_CLOSED_ERROR);
+	} else {
+		command->queued = std::chrono::steady_clock::now();
+		m_serialQueue[priority].push_back(command);
+		m_serialCond.notify_one();
 	}
-	if ((result == NO_ERROR) && rxBufferSize) {
-		result = gigeDevice->ReadSerialPort(rxBuffer, rxBufferSize, &bytesRead, m_timeout);
+	return future;
+}
+
+/**
+ * @param [IN] deadline time in milliseconds a command of this priority may wait in the queue, 0 waits forever
+ */
+void HexitecApi::setSerialDeadline(SerialPriority priority, uint32_t deadline) {
+	if (priority < SERIAL_PRIORITY_COUNT) {
+		m_serialDeadline[priority] = deadline;
 	}
-	mutexLock.unlock();
-	return result;
+}
+
+void HexitecApi::startSerialWorker() {
+	std::unique_lock<std::mutex> lock(mutexLock);
+	m_serialRunning = true;
+	m_serialThread = std::thread(&HexitecApi::serialWorker, this);
+}
+
+void HexitecApi::stopSerialWorker() {
+	std::unique_lock<std::mutex> lock(mutexLock);
+	m_serialRunning = false;
+	m_serialCond.notify_one();
+	lock.unlock();
+	if (m_serialThread.joinable()) {
+		m_serialThread.join();
+	}
+}
+
+/**
+ * Sends the queued commands one at a time, highest priority first and in order of
+ * arrival within a priority. Commands still queued when the worker stops are failed.
+ */
+void HexitecApi::serialWorker() {
+	std::unique_lock<std::mutex> lock(mutexLock);
+
+	while (true) {
+		int priority = SERIAL_PRIORITY_COUNT - 1;
+		while ((priority >= 0) && m_serialQueue[priority].empty()) {
+			priority--;
+		}
+		if (!m_serialRunning) {
+			for (auto& queue : m_serialQueue) {
+				for (auto& command : queue) {
+					command->result.set_value(SERIAL_QUEUE_CLOSED_ERROR);
+				}
+				queue.clear();
+			}
+			break;
+		}
+		if (priority < 0) {
+			m_serialCond.wait(lock);
+			continue;
+		}
+		std::shared_ptr<SerialCommand> command = m_serialQueue[priority].front();
+		m_serialQueue[priority].pop_front();
+		lock.unlock();
+
+		int32_t result = NO_ERROR;
+		auto started = std::chrono::steady_clock::now();
+		if ((command->deadline != std::chrono::steady_clock::time_point()) && (started > command->deadline)) {
+			result = SERIAL_DEADLINE_ERROR;
+		} else {
+			if (command->txBufferSize) {
+				result = gigeDevice->FlushRxBuffer();
+				if (result == NO_ERROR) {
+					result = gigeDevice->WriteSerialPort(const_cast<uint8_t*>(command->txBuffer), command->txBufferSize, &command->bytesWritten);
+				}
+			}
+			if ((result == NO_ERROR) && command->rxBufferSize) {
+				result = gigeDevice->ReadSerialPort(command->rxBuffer, command->rxBufferSize, &command->bytesRead, m_timeout);
+			}
+		}
+		auto finished = std::chrono::steady_clock::now();
+		uint8_t opcode = (command->txBufferSize > 2) ? command->txBuffer[2] : 0;
+		uint32_t bytesWritten = command->bytesWritten;
+		uint32_t bytesRead = command->bytesRead;
+		command->result.set_value(result);
+		lock.lock();
+
+		SerialStatistics& statistics = m_serialStatistics[opcode];
+		statistics.count++;
+		statistics.errors += (result != NO_ERROR);
+		statistics.bytesWritten += bytesWritten;
+		statistics.bytesRead += bytesRead;
+		statistics.queueTime.record(std::chrono::duration_cast<std::chrono::microseconds>(started - command->queued).count());
+		statistics.wireTime.record(std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count());
+	}
+}
+
+/**
+ * Copies the per command code transaction statistics collected by the serial worker.
+ */
+void HexitecApi::getSerialStatistics(std::map<uint8_t, SerialStatistics>& statistics) {
+	std::unique_lock<std::mutex> lock(mutexLock);
+	statistics = m_serialStatistics;
+}
+
+void HexitecApi::resetSerialStatistics() {
+	std::unique_lock<std::mutex> lock(mutexLock);
+	m_serialStatistics.clear();
 }
 
 int32_t HexitecApi::setDAC(double& vCal, double& uMid, double& hvSetPoint, double& detCtrl, double& targetTemperature) {
+	return setDAC(vCal, uMid, hvSetPoint, detCtrl, targetTemperature, SERIAL_PRIORITY_NORMAL);
+}
+
+int32_t HexitecApi::setDAC(double& vCal, double& uMid, double& hvSetPoint, double& detCtrl, double& targetTemperature,
+		SerialPriority priority) {
 	uint8_t txBuffer[24];
 	uint8_t rxBuffer[23];
 	uint32_t bytesWritten = 0;
 	uint32_t bytesRead = 0;
 	int32_t result = NO_ERROR;
 
-	result = checkTemperatureLimit(targetTemperature);
+	result = checkTemperatureLimit(targetTemperature, priority);
 	if (result == NO_ERROR) {
 		txBuffer[0] = 0x23;
 		txBuffer[1] = MODULE_ADDRESS;
@@ -922,7 +1304,7 @@ int32_t HexitecApi::setDAC(double& vCal, double& uMid, double& hvSetPoint, doubl
 		hexToString((uint32_t) dacValFromVoltage(detCtrl), 4, &txBuffer[15]);
 		hexToString((uint32_t) temperatureDacValFromTemperature(targetTemperature), 4, &txBuffer[19]);
 		txBuffer[23] = 0x0d;
-		result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+		result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, priority);
 
 		vCal = dacValToVoltage((uint16_t) stringToHex(&rxBuffer[2], 4));
 		uMid = dacValToVoltage((uint16_t) stringToHex(&rxBuffer[6], 4));
@@ -1039,6 +1421,7 @@ int32_t HexitecApi::writeRegister(uint8_t registerAddress, uint8_t& value) {
 	txBuffer[7] = 0x0d;
 	result = serialPortWriteRead(txBuffer,sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
 	value = (uint8_t) stringToHex(&rxBuffer[4], 2);
+	shadowRegister(registerAddress, value, result == NO_ERROR);
 	return result;
 }
 
@@ -1071,11 +1454,141 @@ int32_t HexitecApi::writeRegisterStream(FpgaRegisterVector &registerStream) {
 		for (auto i = 0; i < registerStream.size(); i++, j+=4) {
 			registerStream[i].value = (uint8_t) stringToHex(&rxBuffer[j], 2);
 		}
+	} else if (result == NO_ERROR) {
+		// a short echo leaves the written values in place, which would pass any verification
+		result = REGISTER_VERIFY_ERROR;
+	}
+	for (auto i = 0; i < registerStream.size(); i++) {
+		shadowRegister(registerStream[i].address, registerStream[i].value, (result == NO_ERROR) && (bytesRead >= rsz));
+	}
+	return result;
+}
+
+/**
+ * Writes the registers in order in streams of up to HEXITEC_MAX_STREAM_REGISTER_COUNT and
+ * checks the values the firmware echoes back, so each stream is written and verified in
+ * one serial round trip.
+ */
+int32_t HexitecApi::writeRegisters(const FpgaRegisterVector& registers) {
+	int32_t result = NO_ERROR;
+	FpgaRegisterVector stream;
+
+	for (size_t first = 0; (result == NO_ERROR) && (first < registers.size()); first += HEXITEC_MAX_STREAM_REGISTER_COUNT) {
+		size_t last = std::min(registers.size(), first + HEXITEC_MAX_STREAM_REGISTER_COUNT);
+		stream.assign(registers.begin() + first, registers.begin() + last);
+		result = writeRegisterStream(stream);
+		for (size_t i = 0; (result == NO_ERROR) && (i < stream.size()); i++) {
+			if (stream[i].value != registers[first + i].value) {
+				result = REGISTER_VERIFY_ERROR;
+			}
+		}
+	}
+	return result;
+}
+
+/**
+ * Appends the sensor configuration registers in the order setSensorConfig always wrote them.
+ */
+void HexitecApi::systemConfigRegisters(FpgaRegisterVector& registers) {
+	registers.push_back({0x07, 0x01});
+	registers.push_back({0x09, m_systemConfig.AdcDelay});
+	registers.push_back({0x0e, m_systemConfig.SyncSignalDelay});
+	registers.push_back({0x14, m_systemConfig.AdcSample});
+}
+
+void HexitecApi::sensorConfigRegisters(const HexitecSensorConfig& sensorConfig, FpgaRegisterVector& registers) {
+	uint8_t setupReg = HEXITEC_SETUP_REGISTER_START_ADDRESS;
+	const uint8_t* setup[] = {
+		sensorConfig.SetupRow.PowerEn, sensorConfig.SetupRow.CalEn, sensorConfig.SetupRow.ReadEn,
+		sensorConfig.SetupCol.PowerEn, sensorConfig.SetupCol.CalEn, sensorConfig.SetupCol.ReadEn
+	};
+
+	registers.push_back({0x06, (uint8_t) sensorConfig.Gain});
+	registers.push_back({0x02, sensorConfig.Row_S1.size1[0]});
+	registers.push_back({0x03, sensorConfig.Row_S1.size1[1]});
+	registers.push_back({0x04, sensorConfig.S1_Sph});
+	registers.push_back({0x05, sensorConfig.Sph_S2});
+	registers.push_back({0x18, sensorConfig.Vcal2_Vcal1.size1[0]});
+	registers.push_back({0x19, sensorConfig.Vcal2_Vcal1.size1[1]});
+	registers.push_back({0x20, 0x00});
+	registers.push_back({0x21, 0x00});
+	registers.push_back({0x22, 0x00});
+	registers.push_back({0x23, 0x00});
+	registers.push_back({0x1a, sensorConfig.WaitClockCol});
+	registers.push_back({0x1b, sensorConfig.WaitClockRow});
+	for (auto bank : setup) {
+		for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
+			registers.push_back({setupReg++, bank[i]});
+		}
+	}
+}
+
+/**
+ * Drops the register shadow and refills it with the operation mode and sensor configuration
+ * registers read from the device. Other configuration registers are read on first use.
+ */
+int32_t HexitecApi::resync() {
+	HexitecOperationMode operationMode;
+	HexitecSensorConfig sensorConfig;
+	int32_t result = NO_ERROR;
+
+	clearRegisterShadow();
+	result = getOperationMode(operationMode);
+	if (result == NO_ERROR) {
+		result = getSensorConfig(sensorConfig);
 	}
 	return result;
 }
 
-int32_t HexitecApi::checkTemperatureLimit(double& temperature) {
+/**
+ * @param [IN] enable read shadowed registers from the device too and report stale entries
+ */
+void HexitecApi::setRegisterCoherenceCheck(bool enable) {
+	m_coherenceCheck = enable;
+}
+
+/**
+ * The register shadow is used from the calling threads, mutexLock guards it like the serial queue.
+ * @return true with the shadowed value if the register is shadowed and valid
+ */
+bool HexitecApi::shadowedRegister(uint8_t registerAddress, uint8_t& value) {
+	std::unique_lock<std::mutex> lock(mutexLock);
+
+	if ((registerAddress < HEXITEC_SHADOW_REGISTER_COUNT) && m_registerShadowValid[registerAddress]) {
+		value = m_registerShadow[registerAddress];
+		return true;
+	}
+	return false;
+}
+
+void HexitecApi::shadowRegister(uint8_t registerAddress, uint8_t value, bool valid) {
+	std::unique_lock<std::mutex> lock(mutexLock);
+
+	if (registerAddress < HEXITEC_SHADOW_REGISTER_COUNT) {
+		m_registerShadow[registerAddress] = value;
+		m_registerShadowValid[registerAddress] = valid;
+	}
+}
+
+// for the set (0x42) and clear (0x43) bit commands, which do not echo the register
+void HexitecApi::shadowRegisterBits(uint8_t registerAddress, uint8_t mask, bool set) {
+	std::unique_lock<std::mutex> lock(mutexLock);
+
+	if ((registerAddress < HEXITEC_SHADOW_REGISTER_COUNT) && m_registerShadowValid[registerAddress]) {
+		if (set) {
+			m_registerShadow[registerAddress] |= mask;
+		} else {
+			m_registerShadow[registerAddress] &= ~mask;
+		}
+	}
+}
+
+void HexitecApi::clearRegisterShadow() {
+	std::unique_lock<std::mutex> lock(mutexLock);
+	m_registerShadowValid.reset();
+}
+
+int32_t HexitecApi::checkTemperatureLimit(double& temperature, SerialPriority priority) {
 	uint8_t txBuffer[4];
 	uint8_t rxBuffer[83];
 	uint32_t bytesWritten = 0;
@@ -1087,7 +1600,7 @@ int32_t HexitecApi::checkTemperatureLimit(double& temperature) {
 	txBuffer[1] = MODULE_ADDRESS;
 	txBuffer[2] = 0x70;
 	txBuffer[3] = 0x0d;
-	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead);
+	result = serialPortWriteRead(txBuffer, sizeof(txBuffer), bytesWritten, rxBuffer, sizeof(rxBuffer), bytesRead, priority);
 
 	detectorType = stringToHex(&rxBuffer[2], 4);
 	switch (detectorType)
@@ -1115,6 +1628,7 @@ int32_t HexitecApi::setOperationMode(HexitecOperationMode operationMode) {
 
 	result = disableSM();
 	if (result == NO_ERROR) {
+        FpgaRegisterVector registers(4);
         value = operationMode.DcUploadDarkCorrectionValues;
         value = value + (operationMode.DcCollectDarkCorrectionValues * 0x02);
         value = value + (operationMode.DcEnableDarkCorrectionCountingMode * 0x04);
@@ -1123,21 +1637,14 @@ int32_t HexitecApi::setOperationMode(HexitecOperationMode operationMode) {
         value = value + (operationMode.DcDisableVcalPulse * 0x20);
         value = value + (operationMode.DcTestMode * 0x40);
         value = value + (operationMode.DcEnableTriggeredCountingMode * 0x80);
-        result = writeRegister(0x24, value);
-	}
-	if (result == NO_ERROR) {
+        registers[0] = {0x24, value};
 		value = operationMode.EdUploadThresholdValues;
 		value = value + (operationMode.EdDisableCountingMode * 0x02);
 		value = value + (operationMode.EdTestMode * 0x04);
-		result = writeRegister(0x27, value);
-	}
-	if (result == NO_ERROR) {
-		value = operationMode.EdCycles.size1[0];
-		result = writeRegister(0x28, value);
-	}
-	if (result == NO_ERROR) {
-		value = operationMode.EdCycles.size1[1];
-		result = writeRegister(0x29, value);
+		registers[1] = {0x27, value};
+		registers[2] = {0x28, operationMode.EdCycles.size1[0]};
+		registers[3] = {0x29, operationMode.EdCycles.size1[1]};
+		result = writeRegisters(registers);
 	}
     if (result == NO_ERROR) {
         result = enableSM();
@@ -1146,104 +1653,9 @@ int32_t HexitecApi::setOperationMode(HexitecOperationMode operationMode) {
 }
 
 int32_t HexitecApi::setSensorConfig(HexitecSensorConfig sensorConfig) {
-	uint8_t value = 0;
-	int32_t result = NO_ERROR;
-//	uint8_t i = 0;
-	uint8_t setupReg = HEXITEC_SETUP_REGISTER_START_ADDRESS;
-
-	value = sensorConfig.Gain;
-	result = writeRegister(0x06, value);
-	if (result == NO_ERROR) {
-		value = sensorConfig.Row_S1.size1[0];
-		result = writeRegister(0x02, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.Row_S1.size1[1];
-		result = writeRegister(0x03, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.S1_Sph;
-		result = writeRegister(0x04, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.Sph_S2;
-		result = writeRegister(0x05, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.Vcal2_Vcal1.size1[0];
-		result = writeRegister(0x18, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.Vcal2_Vcal1.size1[1];
-		result = writeRegister(0x19, value);
-	}
-	if (result == NO_ERROR) {
-		value = 0x00;
-		result = writeRegister(0x20, value);
-	}
-	if (result == NO_ERROR) {
-		value = 0x00;
-		result = writeRegister(0x21, value);
-	}
-	if (result == NO_ERROR) {
-		value = 0x00;
-		result = writeRegister(0x22, value);
-	}
-	if (result == NO_ERROR) {
-		value = 0x00;
-		result = writeRegister(0x23, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.WaitClockCol;
-		result = writeRegister(0x1a, value);
-	}
-	if (result == NO_ERROR) {
-		value = sensorConfig.WaitClockRow;
-		result = writeRegister(0x1b, value);
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupRow.PowerEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupRow.CalEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupRow.ReadEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupCol.PowerEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupCol.CalEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	for (auto i = 0; i < HEXITEC_SETUP_REGISTER_SIZE; i++) {
-		if (result == NO_ERROR) {
-			value = sensorConfig.SetupCol.ReadEn[i];
-			result = writeRegister(setupReg, value);
-		}
-		setupReg++;
-	}
-	return result;
+	FpgaRegisterVector registers;
+	sensorConfigRegisters(sensorConfig, registers);
+	return writeRegisters(registers);
 }
 
 //------------------------------------------------------------------------------
@@ -1303,23 +1715,13 @@ double HexitecApi::getVoltage(uint16_t number, double internalReference) {
 }
 
 int32_t HexitecApi::hexToString(uint32_t number, uint8_t digits, uint8_t* ptr) {
-	std::stringstream ss;
-	ss << std::hex << std::setfill('0') << std::setw(digits)<< std::uppercase << number;
-	std::string s = ss.str();
-	for (auto i=0; i<digits; i++)
-		*ptr++ = s[i];
+	encodeHex(number, digits, ptr);
 	return NO_ERROR;
 }
 
 int32_t HexitecApi::hexToStringLE(uint32_t number, uint8_t digits, uint8_t* ptr )
 {
-	std::stringstream ss;
-	ss << std::hex << std::setfill('0') << std::setw(digits)<< std::uppercase << number;
-	std::string s = ss.str();
-	for (auto i=0; i<digits; i+=2) {
-		*ptr++ = s[digits-i-2];
-		*ptr++ = s[digits-i-1];
-	}
+	encodeHexLE(number, digits, ptr);
 	return NO_ERROR;
 }
 
@@ -1341,12 +1743,7 @@ double HexitecApi::hvDacValToHv(uint16_t number) {
 }
 
 uint32_t HexitecApi::stringToHex(const uint8_t* source, uint8_t digits) {
-	std::stringstream ss, ss2;
-	uint32_t number;
-	ss << source;
-	ss2 << ss.str().substr(0,digits);
-	ss2 >> std::hex >> number;
-	return number;
+	return decodeHex(source, digits);
 }
 
 uint16_t HexitecApi::temperatureDacValFromTemperature(double temperature) {
@@ -1379,4 +1776,11 @@ void HexitecApi::HexitecFinishCb::finished() {
 	m_api.disableTriggerGate();
 }
 
+HexitecApi::HexitecBufferReadyCb::HexitecBufferReadyCb(HexitecApi& api) : m_api(api) {}
+HexitecApi::HexitecBufferReadyCb::~HexitecBufferReadyCb() {}
+void HexitecApi::HexitecBufferReadyCb::bufferReady(p_u8 aTransferBuffer, u32 aCurrentFrameWithinBuffer) {
+	m_api.m_transferBufferCb->bufferReady(aTransferBuffer, aCurrentFrameWithinBuffer);
+	m_api.returnBuffer(aTransferBuffer);
+}
+
 #endif //#ifndef COMPILE_HEXITEC_DUMMY
@@ -16,7 +16,9 @@
 using namespace HexitecAPI;
 
 HexitecApi::HexitecApi(const std::string deviceDescriptor, uint32_t timeout) : m_deviceDescriptor(deviceDescriptor), m_timeout(timeout),
-	m_sensorConfig(), m_operationMode(), m_systemConfig(), m_biasConfig() {
+	m_sensorConfig(), m_operationMode(), m_systemConfig(), m_biasConfig(), m_transferBufferFrameCount(0),
+	m_stopAcquisition(false), m_blockId(0), m_serialRunning(false), m_coherenceCheck(false), m_configurationHash(0) {
+	m_serialDeadline.fill(0);
 }
 
 HexitecApi::~HexitecApi() {
@@ -38,6 +40,14 @@ int32_t HexitecApi::getFramesAcquired() {
 	return 1.0;
 }
 
+int32_t HexitecApi::armAcq() {
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::disarmAcq() {
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::startAcq() {
 	return NO_ERROR;
 }
@@ -70,11 +80,74 @@ int32_t HexitecApi::retrieveBuffer(uint8_t* buffer, uint32_t frametimeout) {
 	return NO_ERROR;
 }
 
+int32_t HexitecApi::retrieveBuffer(uint8_t* buffer, uint32_t frametimeout, HexitecFrameInfo& frameInfo) {
+	frameInfo.BlockId = ++m_blockId;
+	frameInfo.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	return retrieveBuffer(buffer, frametimeout);
+}
+
+int32_t HexitecApi::retrieveBuffer(uint32_t& bufferIndex, uint32_t frametimeout, HexitecFrameInfo& frameInfo) {
+	if (m_attachedBuffers.empty()) {
+		return OPENFILE_ERR;
+	}
+	bufferIndex = m_nextAttachedBuffer++ % m_attachedBuffers.size();
+	return retrieveBuffer(m_attachedBuffers[bufferIndex], frametimeout, frameInfo);
+}
+
+int32_t HexitecApi::requeueBuffer(uint32_t bufferIndex) {
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::reclaimBuffers(std::vector<uint32_t>& bufferIndices, std::vector<HexitecFrameInfo>& frameInfo) {
+	bufferIndices.clear();
+	frameInfo.clear();
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::requeueBuffers(uint32_t firstIndex) {
+	m_nextAttachedBuffer = firstIndex;
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::attachBuffers(std::vector<uint8_t*>& buffers, uint32_t bufferSize) {
+	m_attachedBuffers = buffers;
+	m_nextAttachedBuffer = 0;
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::detachBuffers() {
+	m_attachedBuffers.clear();
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::acquireFrame(uint32_t& frameCount, uint8_t* buffer, uint32_t frametimeout) {
 	return NO_ERROR;
 }
 
 int32_t HexitecApi::acquireFrames(uint32_t frameCount, uint64_t& framesAcquired, uint32_t frametimeout) {
+	const uint32_t frameSize = 80*80*2;
+	uint32_t currentFrameWithinBuffer = 0;
+	framesAcquired = 0;
+	if (m_transferBuffer.empty()) {
+		return NO_ERROR;
+	}
+	m_stopAcquisition = false;
+	while (!m_stopAcquisition && (!frameCount || framesAcquired < frameCount)) {
+		retrieveBuffer(&m_transferBuffer[currentFrameWithinBuffer * frameSize], frametimeout);
+		currentFrameWithinBuffer++;
+		framesAcquired++;
+		if (currentFrameWithinBuffer >= m_transferBufferFrameCount) {
+			if (m_transferBufferCb) {
+				m_transferBufferCb->bufferReady(m_transferBuffer.data(), currentFrameWithinBuffer);
+			}
+			currentFrameWithinBuffer = 0;
+		}
+	}
+	if (currentFrameWithinBuffer && m_transferBufferCb) {
+		m_transferBufferCb->bufferReady(m_transferBuffer.data(), currentFrameWithinBuffer);
+	}
+	m_stopAcquisition = false;
 	return NO_ERROR;
 }
 
@@ -111,23 +184,90 @@ int32_t HexitecApi::configureDetector(uint8_t& width, uint8_t& height, double& f
 	return NO_ERROR;
 }
 
+int32_t HexitecApi::resumeConfiguration(uint8_t& width, uint8_t& height, double& frameTime, uint32_t& collectDcTime) {
+	return configureDetector(width, height, frameTime, collectDcTime);
+}
+
+int32_t HexitecApi::verifyConfiguration(bool& configured) {
+	configured = false;
+	return NO_ERROR;
+}
+
+uint64_t HexitecApi::getConfigurationHash() {
+	return m_configurationHash;
+}
+
 void HexitecApi::copyBuffer(uint8_t* sourceBuffer, uint8_t* destBuffer, uint32_t byteCount) {
 //	memcpy(destBuffer, sourceBuffer, byteCount);
 }
 
 int32_t HexitecApi::createPipeline(uint32_t bufferCount, uint32_t transferBufferCount, uint32_t transferBufferFrameCount) {
+	m_transferBufferFrameCount = transferBufferFrameCount;
+	m_transferBuffer.resize(transferBufferFrameCount * 80*80*2);
 	return NO_ERROR;
 }
 
 int32_t HexitecApi::createPipelineOld(uint32_t bufferCount) {
 	return NO_ERROR;
 }
+
+void HexitecApi::registerTransferBufferCallback(std::shared_ptr<TransferBufferCallback> cbk) {
+	m_transferBufferCb = cbk;
+}
+
+int32_t HexitecApi::getTransferBufferStatistics(uint32_t& highWaterMark, uint32_t& lowWaterMark, uint64_t& underruns) {
+	highWaterMark = 0;
+	lowWaterMark = 0;
+	underruns = 0;
+	return NO_ERROR;
+}
 int32_t HexitecApi::exitDevice() {
 	return NO_ERROR;
 }
 
 int32_t HexitecApi::getBufferHandlingThreadPriority(int32_t& priority )
 {
+	priority = 0;
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::getTimestampTickFrequency(uint64_t& frequency) {
+	frequency = 1000000000;
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::getStreamStatistics(HexitecStreamStatistics& statistics) {
+	statistics.Bandwidth = 0.0;
+	statistics.AcquisitionRate = 0.0;
+	statistics.BlockCount = m_blockId;
+	statistics.BlocksDropped = 0;
+	statistics.BlockIDsMissing = 0;
+	statistics.ResendGroupRequested = 0;
+	statistics.ResendPacketRequested = 0;
+	statistics.PipelineQueueDepth = 0;
+	return NO_ERROR;
+}
+
+uint64_t HexitecApi::blockIdGap(uint64_t previous, uint64_t current) {
+	return GigE::BlockIdGap(previous, current);
+}
+
+bool HexitecApi::blockIdRestarted(uint64_t previous, uint64_t current) {
+	return GigE::BlockIdRestarted(previous, current);
+}
+
+int32_t HexitecApi::setBufferHandlingThreadPriority(int32_t priority) {
+	return NO_ERROR;
+}
+
+int32_t HexitecApi::setBufferHandlingThreadAffinity(const std::vector<int>& cpus) {
+	return NO_ERROR;
+}
+int32_t HexitecApi::setBufferAllocation(uint32_t flags, int32_t numaNode) {
+	return NO_ERROR;
+}
+int32_t HexitecApi::getBufferAllocation(uint32_t& achieved) {
+	achieved = 0;
 	return NO_ERROR;
 }
 int32_t HexitecApi::getDeviceInformation(HexitecDeviceInfo& deviceInfo) {
@@ -233,11 +373,45 @@ int32_t HexitecApi::setFrameFormatControl(const std::string& pixelFormat, uint64
 	return NO_ERROR;
 }
 
+int32_t HexitecApi::setFrameTimeOut(uint32_t frameTimeOut) {
+	return NO_ERROR;
+}
+
 int32_t HexitecApi::setTriggeredFrameCount(uint32_t frameCount) {
 	return NO_ERROR;
 }
 
+int32_t HexitecApi::resync() {
+	return NO_ERROR;
+}
+
+void HexitecApi::setRegisterCoherenceCheck(bool enable) {
+	m_coherenceCheck = enable;
+}
+
+std::future<int32_t> HexitecApi::queueSerialCommand(std::shared_ptr<SerialCommand> command, SerialPriority priority) {
+	command->bytesWritten = command->txBufferSize;
+	command->bytesRead = 0;
+	command->result.set_value(NO_ERROR);
+	return command->result.get_future();
+}
+
+void HexitecApi::setSerialDeadline(SerialPriority priority, uint32_t deadline) {
+	if (priority < SERIAL_PRIORITY_COUNT) {
+		m_serialDeadline[priority] = deadline;
+	}
+}
+
+void HexitecApi::getSerialStatistics(std::map<uint8_t, SerialStatistics>& statistics) {
+	statistics = m_serialStatistics;
+}
+
+void HexitecApi::resetSerialStatistics() {
+	m_serialStatistics.clear();
+}
+
 int32_t HexitecApi::stopAcquisition(){
+	m_stopAcquisition = true;
 	return NO_ERROR;
 }
 
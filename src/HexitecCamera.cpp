@@ -26,8 +26,22 @@
 #include <cfloat>
 #include <future>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
 
 #include <HexitecApi.h>
+#include <BufferAllocator.h>
 
 #include "lima/Debug.h"
 #include "lima/Constants.h"
@@ -37,6 +51,8 @@
 #include "processlib/TaskMgr.h"
 #include "processlib/TaskEventCallback.h"
 #include "HexitecCamera.h"
+#include "HexitecHistoryRing.h"
+#include "HexitecStepGraph.h"
 
 
 using namespace lima;
@@ -45,6 +61,12 @@ using namespace std;
 
 typedef std::chrono::high_resolution_clock Clock;
 
+// automatic buffer sizing: the pipeline only has to ride out the scheduling of the
+// acquisition thread, the Lima ring takes the saving and processing stalls
+const int PIPELINE_STALL_TOLERANCE = 50; // milliseconds
+const int MIN_PIPELINE_BUFFERS = 16;
+const int MIN_LIMA_BUFFERS = 16;
+
 class Camera::TaskEventCb: public TaskEventCallback {
 DEB_CLASS_NAMESPC(DebModCamera, "Camera", "EventCb");
 public:
@@ -55,6 +77,19 @@ private:
 	Camera& m_cam;
 };
 
+//-----------------------------------------------------
+// TransferBufferCb class
+//-----------------------------------------------------
+class Camera::TransferBufferCb: public HexitecAPI::TransferBufferCallback {
+DEB_CLASS_NAMESPC(DebModCamera, "Camera", "TransferBufferCb");
+public:
+	TransferBufferCb(Camera& cam);
+	virtual ~TransferBufferCb();
+	void bufferReady(uint8_t* transferBuffer, uint32_t frameCount);
+private:
+	Camera& m_cam;
+};
+
 //-----------------------------------------------------
 // AcqThread class
 //-----------------------------------------------------
@@ -64,10 +99,25 @@ public:
 	AcqThread(Camera &aCam);
 	virtual ~AcqThread();
 
+	void setScheduling();
+
 protected:
 	virtual void threadFunction();
 
 private:
+	enum RefreshState { REFRESH_EXPOSING, REFRESH_BIAS_OFF, REFRESH_BIAS_ON, REFRESH_SETTLING, REFRESH_PAUSED };
+
+	void startBiasRefreshSchedule();
+	void scheduleBiasRefresh(uint64_t frame, int image_number);
+	void requestBiasRefresh(int request);
+
+	RefreshState m_refresh_state;
+	uint64_t m_interval_frames;
+	uint64_t m_off_frames;
+	uint64_t m_settle_frames;
+	uint64_t m_refresh_next;			///< frame at which the next refresh starts
+	uint64_t m_refresh_step;			///< frame at which the current step ends
+	BiasRefreshWindow m_window;
 	TaskEventCb* m_eventCb;
 	Data m_lastFrame;
 	Camera& m_cam;
@@ -86,9 +136,68 @@ protected:
 	virtual void threadFunction();
 
 private:
+	void refreshOnClock();
+
 	Camera& m_cam;
 };
 
+//-----------------------------------------------------
+// StatisticsThread class
+//-----------------------------------------------------
+class Camera::StatisticsThread: public Thread {
+DEB_CLASS_NAMESPC(DebModCamera, "Camera", "StatisticsThread");
+public:
+	StatisticsThread(Camera &aCam);
+	virtual ~StatisticsThread();
+
+protected:
+	virtual void threadFunction();
+
+private:
+	Camera& m_cam;
+	Cond m_cond;
+	bool m_quit;
+};
+
+//-----------------------------------------------------
+// TelemetryThread class
+//-----------------------------------------------------
+class Camera::TelemetryThread: public Thread {
+DEB_CLASS_NAMESPC(DebModCamera, "Camera", "TelemetryThread");
+public:
+	TelemetryThread(Camera &aCam);
+	virtual ~TelemetryThread();
+
+protected:
+	virtual void threadFunction();
+
+private:
+	Camera& m_cam;
+	Cond m_cond;
+	bool m_quit;
+};
+
+// one hour at the default interval of a second
+static const size_t TELEMETRY_HISTORY_SIZE = 4096;
+
+//-----------------------------------------------------
+// telemetry file layout, little endian as written by the host
+//-----------------------------------------------------
+struct TelemetryFileHeader {
+	char magic[4];                ///< "HXTL"
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t valueCount;
+};
+
+struct TelemetryRecord {
+	double timestamp;             ///< seconds since the epoch
+	int32_t acquisition;          ///< counts startAcq calls since the camera was created
+	int32_t frame;                ///< frames handed to Lima in this acquisition when sampled
+	double values[18];            ///< Camera::Environment then Camera::OperatingValues, in declaration order
+};
+static_assert(sizeof(TelemetryRecord) == 160, "telemetry record layout");
+
 //-----------------------------------------------------
 // internal private structure
 //-----------------------------------------------------
@@ -97,6 +206,15 @@ struct Camera::Private
 	std::unique_ptr<Camera::AcqThread> m_acq_thread;
 	std::unique_ptr<Camera::TimerThread> m_timer_thread;
 	std::unique_ptr<HexitecAPI::HexitecApi> m_hexitec;
+	std::unique_ptr<Camera::StatisticsThread> m_statistics_thread;
+	std::mutex m_statistics_mutex;
+	Camera::StreamStatistics m_stream_statistics;
+	std::unique_ptr<Camera::TelemetryThread> m_telemetry_thread;
+	std::unique_ptr<HistoryRing<Camera::TelemetrySample>> m_telemetry;
+	std::mutex m_telemetry_file_mutex;
+	std::ofstream m_telemetry_file;
+	std::string m_telemetry_filename;
+	std::atomic<int> m_acq_number;
 	std::atomic<bool> m_quit;
 	std::atomic<bool> m_acq_started;
 	std::atomic<bool> m_thread_running;
@@ -104,20 +222,88 @@ struct Camera::Private
 	std::atomic<int> m_image_number;
 	std::atomic<int> m_status;
 	std::future<void> m_future_result;
+	int m_pipelineFrameCount;
+	int m_pipelineBufferCount;
+	int m_limaBufferCount;
+	uint32_t m_allocationFlags;
+	int m_numaNode;
+	std::string m_bufferAllocation;
+	uint64_t m_tickFrequency;
+	Clock::time_point m_start_request;
+	Clock::time_point m_bias_settled;	///< end of the settle wait started by prepareAcq
+	std::string m_initialise_report;
+	// bias refresh scheduled by the acquisition loop, carried out by the timer thread
+	std::mutex m_refresh_mutex;
+	std::condition_variable m_refresh_cond;
+	int m_refresh_request;
+	std::atomic<int> m_refresh_done;
+	std::atomic<bool> m_refresh_by_frames;
+	Clock::time_point m_last_refresh;
+	std::vector<Camera::BiasRefreshWindow> m_refresh_windows;
 };
 
+// requests from the acquisition loop to the timer thread
+enum RefreshRequest { REFRESH_NONE, REFRESH_REQUEST_BIAS_OFF, REFRESH_REQUEST_BIAS_ON };
+
+//-----------------------------------------------------
+// @brief identifies the configuration file and firmware a detector was configured with
+//-----------------------------------------------------
+static std::string configFingerprint(uint64_t configHash, uint8_t customerId, uint8_t projectId, uint8_t version) {
+	std::ostringstream os;
+	os << "hexitec-config 1 " << std::hex << std::setfill('0') << std::setw(16) << configHash
+			<< " " << std::setw(2) << int(customerId) << " " << std::setw(2) << int(projectId)
+			<< " " << std::setw(2) << int(version);
+	return os.str();
+}
+
+//-----------------------------------------------------
+// @brief parse a cpu list like "2,4-5" into core numbers
+//-----------------------------------------------------
+static bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+	std::istringstream in(text);
+	std::string item;
+	int ncpus = sysconf(_SC_NPROCESSORS_CONF);
+	cpus.clear();
+	while (std::getline(in, item, ',')) {
+		int first, last;
+		char dash;
+		std::istringstream range(item);
+		if (!(range >> first)) {
+			return false;
+		}
+		last = first;
+		if (range >> dash && (dash != '-' || !(range >> last))) {
+			return false;
+		}
+		if (first < 0 || last < first || last >= ncpus || last >= CPU_SETSIZE) {
+			return false;
+		}
+		for (auto cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return true;
+}
+
 
 //-----------------------------------------------------
 // @brief camera constructor
 //-----------------------------------------------------
-Camera::Camera(const std::string& ipAddress, const std::string& configFilename, int bufferCount, int timeout, int asicPitch) :
-		m_ipAddress(ipAddress), m_configFilename(configFilename), m_bufferCount(bufferCount), m_timeout(timeout),
+Camera::Camera(const std::string& ipAddress, const std::string& configFilename, int bufferCount, int timeout, int asicPitch,
+		const std::string& configStateFilename) :
+		m_ipAddress(ipAddress), m_configFilename(configFilename), m_configStateFilename(configStateFilename),
+		m_bufferCount(bufferCount), m_timeout(timeout),
 		m_asicPitch(asicPitch), m_trig_mode(IntTrig),
 		m_detectorImageType(Bpp16), m_detector_type("Hexitec"), m_detector_model("V1.0.0"), m_maxImageWidth(80),
 		m_maxImageHeight(80), m_x_pixelsize(1), m_y_pixelsize(1), m_offset_x(0), m_offset_y(0),
-		m_collectDcTimeout(10000), m_processType(ProcessType::CSA),
+		m_collectDcTimeout(10000), m_processType(ProcessType::RAW),
 		m_saveOpt(Camera::SaveRaw), m_binWidth(10), m_speclen(8000), m_lowThreshold(0), m_highThreshold(10000),
-		m_biasVoltageRefreshInterval(10000), m_biasVoltageRefreshTime(5000), m_biasVoltageSettleTime(2000) {
+		m_eventThreshold(10), m_eventMaxEnergy(65535), m_chargeSharingKernel(3),
+		m_biasVoltageRefreshInterval(10000), m_biasVoltageRefreshTime(5000), m_biasVoltageSettleTime(2000),
+		m_zeroCopy(false), m_transferBufferFrameCount(0), m_acqThreadPriority(0), m_missingFrameCount(0), m_discardedFrameCount(0),
+		m_statisticsInterval(1000), m_bufferMemoryBudget(0), m_stallTolerance(0),
+		m_hugePages(false), m_lockBuffers(false), m_numaBinding(false), m_preArm(false), m_startLatency(0.), m_biasSettleTolerance(5.), m_biasSettleTime(0.),
+		m_registerCoherenceCheck(false), m_telemetryDeadline(0), m_telemetryInterval(1000) {
 
 	DEB_CONSTRUCTOR();
 
@@ -126,6 +312,10 @@ Camera::Camera(const std::string& ipAddress, const std::string& configFilename,
 	m_private = std::shared_ptr<Private>(new Private);
 	m_private->m_acq_started = false;
 	m_private->m_quit = false;
+	m_private->m_acq_number = 0;
+	m_private->m_refresh_request = REFRESH_NONE;
+	m_private->m_refresh_done = REFRESH_NONE;
+	m_private->m_refresh_by_frames = false;
 	m_framesPerTrigger = 0;
 
 	m_bufferCtrlObj = new SoftBufferCtrlObj();
@@ -144,6 +334,16 @@ Camera::Camera(const std::string& ipAddress, const std::string& configFilename,
 	m_private->m_timer_thread = std::unique_ptr < TimerThread > (new TimerThread(*this));
 	m_private->m_timer_thread->start();
 
+	// Stream statistics sampling
+	m_private->m_stream_statistics = StreamStatistics();
+	m_private->m_statistics_thread = std::unique_ptr < StatisticsThread > (new StatisticsThread(*this));
+	m_private->m_statistics_thread->start();
+
+	// Telemetry sampling, clients read the history instead of the serial port
+	m_private->m_telemetry = std::unique_ptr < HistoryRing<TelemetrySample> > (new HistoryRing<TelemetrySample>(TELEMETRY_HISTORY_SIZE));
+	m_private->m_telemetry_thread = std::unique_ptr < TelemetryThread > (new TelemetryThread(*this));
+	m_private->m_telemetry_thread->start();
+
 	setStatus(Camera::Ready);
 	DEB_TRACE() << "Camera constructor complete";
 }
@@ -153,6 +353,9 @@ Camera::Camera(const std::string& ipAddress, const std::string& configFilename,
 //-----------------------------------------------------
 Camera::~Camera() {
 	DEB_DESTRUCTOR();
+	// stop sampling before the stream goes away
+	m_private->m_statistics_thread.reset();
+	m_private->m_telemetry_thread.reset();
 	setHvBiasOff();
 	m_private->m_hexitec->closePipeline();
 	m_private->m_hexitec->closeStream();
@@ -165,114 +368,197 @@ Camera::~Camera() {
 //----------------------------------------------------------------------------
 void Camera::initialise() {
 	DEB_MEMBER_FUNCT();
-	int32_t rc;
-	uint32_t errorCode;
-	std::string errorCodeString;
-	std::string errorDescription;
-	if (m_private->m_hexitec->readConfiguration(m_configFilename) != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to read the configuration file " << DEB_VAR1(m_configFilename);
-	}
-
-	m_private->m_hexitec->initDevice(errorCode, errorCodeString, errorDescription);
-	if (errorCode != HexitecAPI::NO_ERROR) {
-		DEB_TRACE() << "Error      :" << errorCodeString;
-		DEB_TRACE() << "Description:" << errorDescription;
-		THROW_HW_ERROR(Error) << errorDescription << " " << DEB_VAR1(errorCode);
-	}
-	DEB_TRACE() << "Error code :" << errorCode;
-
-	uint8_t useTermChar = true;
-	rc = m_private->m_hexitec->openSerialPortBulk0((2 << 16), useTermChar, 0x0d);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to open serial port " << DEB_VAR1(rc);
-	}
 	uint8_t customerId;
 	uint8_t projectId;
 	uint8_t version;
-	uint8_t forceEqualVersion = false;
-	rc = m_private->m_hexitec->checkFirmware(customerId, projectId, version, forceEqualVersion);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to read firmware version information " << DEB_VAR1(rc);
-	}
-	DEB_TRACE() << "customerId :" << int(customerId);
-	DEB_TRACE() << "projectId  :" << int(projectId);
-	DEB_TRACE() << "version    :" << int(version);
+	StepGraph steps;
 
-	uint8_t width;
-	uint8_t height;
-	uint32_t collectDcTime;
+	// The serial configuration and the stream setup only share the connection, so the
+	// two chains run side by side once the device is open.
+	size_t config = steps.add("readConfiguration", [&] {
+		if (m_private->m_hexitec->readConfiguration(m_configFilename) != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to read the configuration file " << DEB_VAR1(m_configFilename);
+		}
+	});
+
+	size_t device = steps.add("initDevice", [&] {
+		uint32_t errorCode;
+		std::string errorCodeString;
+		std::string errorDescription;
+		m_private->m_hexitec->initDevice(errorCode, errorCodeString, errorDescription);
+		if (errorCode != HexitecAPI::NO_ERROR) {
+			DEB_TRACE() << "Error      :" << errorCodeString;
+			DEB_TRACE() << "Description:" << errorDescription;
+			THROW_HW_ERROR(Error) << errorDescription << " " << DEB_VAR1(errorCode);
+		}
+		DEB_TRACE() << "Error code :" << errorCode;
+	});
+
+	size_t serial = steps.add("openSerialPort", [&] {
+		uint8_t useTermChar = true;
+		int32_t rc = m_private->m_hexitec->openSerialPortBulk0((2 << 16), useTermChar, 0x0d);
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to open serial port " << DEB_VAR1(rc);
+		}
+	}, {device});
 
-	rc = m_private->m_hexitec->configureDetector(width, height, m_frameTime, collectDcTime);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to configure the detector " << DEB_VAR1(rc);
-	}
-	DEB_TRACE() << "width         :" << int(width);
-	DEB_TRACE() << "height        :" << int(height);
-	DEB_TRACE() << "frameTime     :" << m_frameTime;
-	DEB_TRACE() << "collectDcTime :" << collectDcTime;
-
-	double humidity;
-	double ambientTemperature;
-	double asicTemperature;
-	double adcTemperature;
-	double ntcTemperature;
-	rc = m_private->m_hexitec->readEnvironmentValues(humidity, ambientTemperature, asicTemperature, adcTemperature, ntcTemperature);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to read environmental values " << DEB_VAR1(rc);
-	}
-	DEB_TRACE() << "humidity           :" << humidity;
-	DEB_TRACE() << "ambientTemperature :" << ambientTemperature;
-	DEB_TRACE() << "asicTemperature    :" << asicTemperature;
-	DEB_TRACE() << "adcTemperature     :" << adcTemperature;
-	DEB_TRACE() << "ntcTemperature     :" << ntcTemperature;
-	double v3_3;
-	double hvMon;
-	double hvOut;
-	double v1_2;
-	double v1_8;
-	double v3;
-	double v2_5;
-	double v3_3ln;
-	double v1_65ln;
-	double v1_8ana;
-	double v3_8ana;
-	double peltierCurrent;
-
-	rc = m_private->m_hexitec->readOperatingValues(v3_3, hvMon, hvOut, v1_2, v1_8, v3, v2_5, v3_3ln, v1_65ln, v1_8ana, v3_8ana, peltierCurrent,
-			ntcTemperature);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to read operating values" << DEB_VAR1(rc);
-	}
-	DEB_TRACE() << "v3_3           :" << v3_3;
-	DEB_TRACE() << "hvMon          :" << hvMon;
-	DEB_TRACE() << "hvOut          :" << hvOut;
-	DEB_TRACE() << "v1_2           :" << v1_2;
-	DEB_TRACE() << "v1_8           :" << v1_8;
-	DEB_TRACE() << "v3             :" << v3;
-	DEB_TRACE() << "v2_5           :" << v2_5;
-	DEB_TRACE() << "v3_3ln         :" << v3_3ln;
-	DEB_TRACE() << "v1_65ln        :" << v1_65ln;
-	DEB_TRACE() << "v1_8ana        :" << v1_8ana;
-	DEB_TRACE() << "v3_8ana        :" << v3_8ana;
-	DEB_TRACE() << "peltierCurrent :" << peltierCurrent;
-	DEB_TRACE() << "ntcTemperature :" << ntcTemperature;
-
-	rc = m_private->m_hexitec->setFrameFormatControl("Mono16", m_maxImageWidth, m_maxImageHeight, m_offset_x, m_offset_y, "One", "Off"); //IPEngineTestPattern");
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to set frame format control " << DEB_VAR1(rc);
-	}
+	size_t firmware = steps.add("checkFirmware", [&] {
+		uint8_t forceEqualVersion = false;
+		int32_t rc = m_private->m_hexitec->checkFirmware(customerId, projectId, version, forceEqualVersion);
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to read firmware version information " << DEB_VAR1(rc);
+		}
+		DEB_TRACE() << "customerId :" << int(customerId);
+		DEB_TRACE() << "projectId  :" << int(projectId);
+		DEB_TRACE() << "version    :" << int(version);
+	}, {serial});
+
+	size_t configure = steps.add("configureDetector", [&] {
+		int32_t rc;
+		uint8_t width;
+		uint8_t height;
+		uint32_t collectDcTime;
+
+		// a detector still configured from the same file and firmware is only verified,
+		// the state file records the last configuration applied from this host
+		std::string fingerprint = configFingerprint(m_private->m_hexitec->getConfigurationHash(), customerId, projectId, version);
+		bool configured = false;
+		if (!m_configStateFilename.empty()) {
+			std::ifstream stateFile(m_configStateFilename);
+			std::string applied;
+			if (std::getline(stateFile, applied) && (applied == fingerprint)) {
+				rc = m_private->m_hexitec->verifyConfiguration(configured);
+				if (rc != HexitecAPI::NO_ERROR) {
+					DEB_WARNING() << "Failed to verify the detector configuration " << DEB_VAR1(rc);
+					configured = false;
+				}
+			}
+		}
+		if (configured) {
+			DEB_TRACE() << "Detector configuration unchanged, only rewriting the run-time registers";
+			rc = m_private->m_hexitec->resumeConfiguration(width, height, m_frameTime, collectDcTime);
+		} else {
+			// no longer valid if configuring fails half way
+			if (!m_configStateFilename.empty()) {
+				std::remove(m_configStateFilename.c_str());
+			}
+			rc = m_private->m_hexitec->configureDetector(width, height, m_frameTime, collectDcTime);
+		}
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to configure the detector " << DEB_VAR1(rc);
+		}
+		if (!configured && !m_configStateFilename.empty()) {
+			std::ofstream stateFile(m_configStateFilename, std::ios::trunc);
+			stateFile << fingerprint << std::endl;
+			if (!stateFile) {
+				DEB_WARNING() << "Failed to write the configuration state file " << DEB_VAR1(m_configStateFilename);
+			}
+		}
+		DEB_TRACE() << "width         :" << int(width);
+		DEB_TRACE() << "height        :" << int(height);
+		DEB_TRACE() << "frameTime     :" << m_frameTime;
+		DEB_TRACE() << "collectDcTime :" << collectDcTime;
+	}, {config, firmware});
+
+	steps.add("readMonitorValues", [&] {
+		double humidity;
+		double ambientTemperature;
+		double asicTemperature;
+		double adcTemperature;
+		double ntcTemperature;
+		int32_t rc = m_private->m_hexitec->readEnvironmentValues(humidity, ambientTemperature, asicTemperature, adcTemperature, ntcTemperature);
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to read environmental values " << DEB_VAR1(rc);
+		}
+		DEB_TRACE() << "humidity           :" << humidity;
+		DEB_TRACE() << "ambientTemperature :" << ambientTemperature;
+		DEB_TRACE() << "asicTemperature    :" << asicTemperature;
+		DEB_TRACE() << "adcTemperature     :" << adcTemperature;
+		DEB_TRACE() << "ntcTemperature     :" << ntcTemperature;
+		double v3_3;
+		double hvMon;
+		double hvOut;
+		double v1_2;
+		double v1_8;
+		double v3;
+		double v2_5;
+		double v3_3ln;
+		double v1_65ln;
+		double v1_8ana;
+		double v3_8ana;
+		double peltierCurrent;
+
+		rc = m_private->m_hexitec->readOperatingValues(v3_3, hvMon, hvOut, v1_2, v1_8, v3, v2_5, v3_3ln, v1_65ln, v1_8ana, v3_8ana, peltierCurrent,
+				ntcTemperature);
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to read operating values" << DEB_VAR1(rc);
+		}
+		DEB_TRACE() << "v3_3           :" << v3_3;
+		DEB_TRACE() << "hvMon          :" << hvMon;
+		DEB_TRACE() << "hvOut          :" << hvOut;
+		DEB_TRACE() << "v1_2           :" << v1_2;
+		DEB_TRACE() << "v1_8           :" << v1_8;
+		DEB_TRACE() << "v3             :" << v3;
+		DEB_TRACE() << "v2_5           :" << v2_5;
+		DEB_TRACE() << "v3_3ln         :" << v3_3ln;
+		DEB_TRACE() << "v1_65ln        :" << v1_65ln;
+		DEB_TRACE() << "v1_8ana        :" << v1_8ana;
+		DEB_TRACE() << "v3_8ana        :" << v3_8ana;
+		DEB_TRACE() << "peltierCurrent :" << peltierCurrent;
+		DEB_TRACE() << "ntcTemperature :" << ntcTemperature;
+	}, {configure});
+
+	size_t format = steps.add("setFrameFormatControl", [&] {
+		int32_t rc = m_private->m_hexitec->setFrameFormatControl("Mono16", m_maxImageWidth, m_maxImageHeight, m_offset_x, m_offset_y, "One", "Off"); //IPEngineTestPattern");
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to set frame format control " << DEB_VAR1(rc);
+		}
+	}, {device});
 
 	//openStream needs to be called before createPipeline
-	rc = m_private->m_hexitec->openStream();
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to open stream" << DEB_VAR1(rc);
-	}
-	rc = m_private->m_hexitec->closePipeline();
-	DEB_TRACE() << "setting buffer count to " << m_bufferCount;
-	rc = m_private->m_hexitec->createPipelineOnly(m_bufferCount);
-	if (rc != HexitecAPI::NO_ERROR) {
-		THROW_HW_ERROR(Error) << "Failed to create pipeline" << DEB_VAR1(rc);
+	size_t stream = steps.add("openStream", [&] {
+		int32_t rc = m_private->m_hexitec->openStream();
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to open stream" << DEB_VAR1(rc);
+		}
+	}, {format});
+
+	steps.add("createPipeline", [&] {
+		m_private->m_hexitec->closePipeline();
+		DEB_TRACE() << "setting buffer count to " << m_bufferCount;
+		int32_t rc = m_private->m_hexitec->createPipelineOnly(m_bufferCount);
+		if (rc != HexitecAPI::NO_ERROR) {
+			THROW_HW_ERROR(Error) << "Failed to create pipeline" << DEB_VAR1(rc);
+		}
+	}, {stream});
+
+	try {
+		steps.run();
+	} catch (...) {
+		m_private->m_initialise_report = steps.report();
+		DEB_ERROR() << "initialise failed:\n" << m_private->m_initialise_report;
+		throw;
 	}
+	m_private->m_initialise_report = steps.report();
+	DEB_TRACE() << "initialise steps:\n" << m_private->m_initialise_report;
+
+	m_private->m_pipelineFrameCount = 0;
+	m_private->m_pipelineBufferCount = m_bufferCount;
+	m_private->m_limaBufferCount = m_bufferCount;
+	m_private->m_allocationFlags = 0;
+	m_private->m_numaNode = -1;
+	m_private->m_hexitec->registerTransferBufferCallback(std::make_shared<TransferBufferCb>(*this));
+
+	std::string report;
+	getSerialStatistics(report);
+	DEB_TRACE() << "serial transactions during initialise:\n" << report;
+}
+
+//-----------------------------------------------------------------------------
+// @brief Step timings of the last initialise
+//-----------------------------------------------------------------------------
+void Camera::getInitialiseReport(std::string& report) {
+	report = m_private->m_initialise_report;
 }
 
 //-----------------------------------------------------------------------------
@@ -280,11 +566,16 @@ void Camera::initialise() {
 //-----------------------------------------------------------------------------
 void Camera::prepareAcq() {
 	DEB_MEMBER_FUNCT();
+	// an acquisition armed by an earlier prepareAcq that was never started
+	m_private->m_hexitec->disarmAcq();
 	m_private->m_image_number = 0;
 	setHvBiasOn();
-	// wait asynchronously for the HV Bias to settle
-	// check the result before start acquisition in Acq thread.
-	m_private->m_future_result = std::async(std::launch::async, [=] {std::chrono::milliseconds(m_biasVoltageRefreshTime);});
+	// wait asynchronously for the HV Bias to settle while the buffers are set up,
+	// the Acq thread waits for the result before starting the acquisition
+	m_private->m_future_result = std::async(std::launch::async, [this] {
+		waitForBiasSettle();
+		m_private->m_bias_settled = Clock::now();
+	});
 
 	Size image_size;
     ImageType image_type;
@@ -293,8 +584,119 @@ void Camera::prepareAcq() {
     getImageType(image_type);
 
     FrameDim frame_dim(image_size, image_type);
+    int pipeline_buffers, lima_buffers;
+    computeBufferDepths(frame_dim, pipeline_buffers, lima_buffers);
     m_bufferCtrlObj->setFrameDim(frame_dim);
-    m_bufferCtrlObj->setNbBuffers(m_bufferCount);
+    m_bufferCtrlObj->setNbBuffers(lima_buffers);
+
+    uint32_t alloc_flags = (m_hugePages ? GigE::BUFFER_ALLOCATION_HUGEPAGES : 0)
+            | (m_lockBuffers ? GigE::BUFFER_ALLOCATION_LOCKED : 0)
+            | (m_numaBinding ? GigE::BUFFER_ALLOCATION_NUMA : 0);
+    int numa_node = -1;
+    if (m_numaBinding) {
+        numa_node = GigE::BufferAllocator::NumaNodeOfPeer(m_ipAddress);
+        if (numa_node < 0) {
+            DEB_WARNING() << "No NUMA node found for the interface to " << m_ipAddress;
+        }
+    }
+    uint32_t lima_achieved = 0;
+    std::string lima_error;
+    uint32_t dropped_flags = m_private->m_allocationFlags & ~alloc_flags;
+    if (alloc_flags || dropped_flags) {
+        // the ring is allocated by Lima, only advise, bind and lock what is there: one call
+        // per contiguous block of frames keeps the number of memory mappings down
+        StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj->getBuffer();
+        std::vector<std::pair<char*, size_t>> blocks;
+        for (auto i = 0; i < lima_buffers; i++) {
+            char* ptr = (char*) buffer_mgr.getFrameBufferPtr(i);
+            if (!blocks.empty() && blocks.back().first + blocks.back().second == ptr) {
+                blocks.back().second += frame_dim.getMemSize();
+            } else {
+                blocks.emplace_back(ptr, frame_dim.getMemSize());
+            }
+        }
+        GigE::BufferAllocator allocator;
+        allocator.SetMode(alloc_flags, numa_node);
+        lima_achieved = alloc_flags ? ~0u : 0;
+        for (auto& block : blocks) {
+            if (dropped_flags && !allocator.Reset(block.first, block.second, dropped_flags) && lima_error.empty()) {
+                lima_error = allocator.GetError();
+            }
+            if (alloc_flags) {
+                lima_achieved &= allocator.Prepare(block.first, block.second);
+                if (!allocator.GetError().empty() && lima_error.empty()) {
+                    lima_error = allocator.GetError();
+                }
+            }
+        }
+    }
+    bool realloc = alloc_flags != m_private->m_allocationFlags || numa_node != m_private->m_numaNode;
+    if (realloc) {
+        m_private->m_hexitec->setBufferAllocation(alloc_flags, numa_node);
+    }
+
+    if (realloc || m_transferBufferFrameCount != m_private->m_pipelineFrameCount || pipeline_buffers != m_private->m_pipelineBufferCount) {
+        // the pipeline has to be rebuilt to resize it or to add or remove the transfer buffers
+        int32_t rc = m_private->m_hexitec->closePipeline();
+        if (rc == HexitecAPI::NO_ERROR) {
+            if (m_transferBufferFrameCount) {
+                // frames are copied out inside the callback, so the buffer is back before the next one is needed
+                rc = m_private->m_hexitec->createPipeline(pipeline_buffers, 2, m_transferBufferFrameCount);
+            } else {
+                rc = m_private->m_hexitec->createPipelineOnly(pipeline_buffers);
+            }
+        }
+        if (rc != HexitecAPI::NO_ERROR) {
+            THROW_HW_ERROR(Error) << "Failed to create pipeline " << DEB_VAR1(rc);
+        }
+        m_private->m_pipelineFrameCount = m_transferBufferFrameCount;
+        m_private->m_pipelineBufferCount = pipeline_buffers;
+        m_private->m_allocationFlags = alloc_flags;
+        m_private->m_numaNode = numa_node;
+    }
+
+    uint32_t transfer_achieved = 0;
+    if (m_transferBufferFrameCount) {
+        m_private->m_hexitec->getBufferAllocation(transfer_achieved);
+    }
+    std::string allocation = "Lima ring " + GigE::BufferAllocator::Describe(lima_achieved, numa_node);
+    if (!lima_error.empty()) {
+        allocation += " (" + lima_error + ")";
+    }
+    if (m_transferBufferFrameCount) {
+        allocation += ", transfer buffers " + GigE::BufferAllocator::Describe(transfer_achieved, numa_node);
+    }
+    if (allocation != m_private->m_bufferAllocation) {
+        DEB_ALWAYS() << "Buffer allocation: " << allocation;
+        m_private->m_bufferAllocation = allocation;
+    }
+    if (m_transferBufferFrameCount) {
+        m_private->m_hexitec->setFrameTimeOut(m_timeout);
+    }
+
+    uint64_t tick_frequency;
+    if (m_private->m_hexitec->getTimestampTickFrequency(tick_frequency) != HexitecAPI::NO_ERROR) {
+        DEB_WARNING() << "No device timestamp tick frequency, frames are timed by the host";
+        tick_frequency = 0;
+    }
+    m_private->m_tickFrequency = tick_frequency;
+
+    if (m_zeroCopy && !m_transferBufferFrameCount) {
+        // hand the Lima frame ring to the stream so frames are received in place
+        StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj->getBuffer();
+        int nb_buffers;
+        m_bufferCtrlObj->getNbBuffers(nb_buffers);
+        std::vector<uint8_t*> buffers(nb_buffers);
+        for (auto i = 0; i < nb_buffers; i++) {
+            buffers[i] = (uint8_t*) buffer_mgr.getFrameBufferPtr(i);
+        }
+        auto rc = m_private->m_hexitec->attachBuffers(buffers, frame_dim.getMemSize());
+        if (rc != HexitecAPI::NO_ERROR) {
+            THROW_HW_ERROR(Error) << "Failed to attach the frame buffers " << DEB_VAR1(rc);
+        }
+    } else {
+        m_private->m_hexitec->detachBuffers();
+    }
 
     if (m_framesPerTrigger == 0)
         m_framesPerTrigger = m_nb_frames;
@@ -302,6 +704,68 @@ void Camera::prepareAcq() {
         DEB_ALWAYS() << "Number of frames per trigger " << m_framesPerTrigger;
         m_private->m_hexitec->setTriggeredFrameCount(m_framesPerTrigger);
     }
+
+    if (m_preArm && !m_transferBufferFrameCount) {
+        // reset, pipeline start and stream enable now, startAcq only sends the start command.
+        // The pipeline thread started here takes the scheduling of the acquisition thread
+        cpu_set_t caller_cpus;
+        int caller_policy;
+        struct sched_param caller_param;
+        bool restore = pthread_getaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus) == 0
+                && pthread_getschedparam(pthread_self(), &caller_policy, &caller_param) == 0;
+        m_private->m_acq_thread->setScheduling();
+        auto rc = m_private->m_hexitec->armAcq();
+        if (restore) {
+            pthread_setaffinity_np(pthread_self(), sizeof(caller_cpus), &caller_cpus);
+            pthread_setschedparam(pthread_self(), caller_policy, &caller_param);
+        }
+        if (rc != HexitecAPI::NO_ERROR) {
+            m_private->m_hexitec->disarmAcq();
+            THROW_HW_ERROR(Error) << "Failed to arm the acquisition " << DEB_VAR1(rc);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// @brief size the pipeline and the Lima ring. Without a memory budget or stall
+// tolerance both get bufferCount frames. A budget that cannot hold the pipeline
+// and the smallest Lima ring is refused.
+//-----------------------------------------------------------------------------
+void Camera::computeBufferDepths(const FrameDim& frame_dim, int& pipeline_buffers, int& lima_buffers) {
+	DEB_MEMBER_FUNCT();
+	pipeline_buffers = m_bufferCount;
+	lima_buffers = m_bufferCount;
+	if ((m_bufferMemoryBudget || m_stallTolerance) && m_frameTime > 0) {
+		double frame_rate = 1.0 / m_frameTime;
+		int64_t frame_size = frame_dim.getMemSize();
+		pipeline_buffers = std::max(MIN_PIPELINE_BUFFERS, int(std::ceil(PIPELINE_STALL_TOLERANCE / 1000.0 * frame_rate)));
+		lima_buffers = std::numeric_limits<int>::max();
+		if (m_stallTolerance) {
+			lima_buffers = int(std::ceil(m_stallTolerance / 1000.0 * frame_rate));
+		}
+		if (m_bufferMemoryBudget) {
+			// the pipeline buffers and the two transfer buffers come out of the budget first
+			int64_t pipeline_frames = pipeline_buffers + 2 * int64_t(m_transferBufferFrameCount);
+			int64_t budget_frames = int64_t(m_bufferMemoryBudget) * 1024 * 1024 / frame_size - pipeline_frames;
+			if (budget_frames < MIN_LIMA_BUFFERS) {
+				THROW_HW_ERROR(InvalidValue) << "Memory budget too small for " << pipeline_frames
+						<< " pipeline frames and a Lima ring of " << MIN_LIMA_BUFFERS << " "
+						<< DEB_VAR2(m_bufferMemoryBudget, frame_size);
+			}
+			if (budget_frames < lima_buffers) {
+				if (m_stallTolerance) {
+					DEB_WARNING() << "Memory budget only covers " << budget_frames * m_frameTime * 1000 << " ms "
+							<< DEB_VAR2(m_bufferMemoryBudget, m_stallTolerance);
+				}
+				lima_buffers = int(budget_frames);
+			}
+		}
+		int max_buffers;
+		m_bufferCtrlObj->getMaxNbBuffers(max_buffers);
+		lima_buffers = std::min(std::max(lima_buffers, MIN_LIMA_BUFFERS), max_buffers);
+	}
+	m_private->m_limaBufferCount = lima_buffers;
+	DEB_TRACE() << DEB_VAR2(pipeline_buffers, lima_buffers);
 }
 
 //-----------------------------------------------------------------------------
@@ -311,6 +775,18 @@ void Camera::startAcq() {
 	DEB_MEMBER_FUNCT();
 	AutoMutex lock(m_cond.mutex());
 	m_errCount = 0;
+	m_missingFrameCount = 0;
+	m_discardedFrameCount = 0;
+	m_private->m_start_request = Clock::now();
+	{
+		// batched acquisitions have no frame loop, their refresh follows the wall clock
+		std::lock_guard<std::mutex> guard(m_private->m_refresh_mutex);
+		m_private->m_refresh_by_frames = (m_transferBufferFrameCount == 0) && (m_frameTime > 0.);
+		m_private->m_refresh_request = REFRESH_NONE;
+		m_private->m_last_refresh = Clock::now();
+		m_private->m_refresh_windows.clear();
+	}
+	m_private->m_acq_number++;
 	m_private->m_acq_started = true;
 	m_saved_frame_nb = 0;
 	m_cond.broadcast();
@@ -324,6 +800,8 @@ void Camera::stopAcq() {
 	AutoMutex lock(m_cond.mutex());
 	if (m_private->m_acq_started)
 		m_private->m_acq_started = false;
+	// wakes the acquisition thread within one frame time instead of one frame timeout
+	m_private->m_hexitec->stopAcquisition();
 }
 
 //-----------------------------------------------------------------------------
@@ -587,6 +1065,7 @@ void Camera::AcqThread::threadFunction() {
 	DEB_MEMBER_FUNCT();
 	int32_t rc;
 	uint16_t* bptr;
+	uint32_t bufferIndex;
 	auto trigger_failed = false;
 	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj->getBuffer();
 	buffer_mgr.setStartTimestamp(Timestamp::now());
@@ -607,38 +1086,213 @@ void Camera::AcqThread::threadFunction() {
 		m_cam.setStatus(Camera::Exposure);
 
 		bool continue_acq = true;
+		setScheduling();
+		bool batched = m_cam.m_transferBufferFrameCount > 0;
 		try {
 			m_cam.m_private->m_future_result.get();
 			DEB_ALWAYS() << "Starting acquisition";
-			rc = m_cam.m_private->m_hexitec->startAcq();
+			// in batched mode acquireFrames starts the detector itself
+			rc = batched ? HexitecAPI::NO_ERROR : m_cam.m_private->m_hexitec->startAcq();
+			if (!batched) {
+				// a start requested before the bias settled counts from the end of the wait,
+				// which is reported on its own as the bias settle time
+				auto from = std::max(m_cam.m_private->m_start_request, m_cam.m_private->m_bias_settled);
+				m_cam.m_startLatency = std::chrono::duration<double, std::milli>(Clock::now() - from).count();
+				DEB_TRACE() << "Start latency " << m_cam.m_startLatency << " ms";
+			}
 			if (rc != HexitecAPI::NO_ERROR) {
 				DEB_ERROR() << "Failed to start acquisition " << DEB_VAR1(rc);
 				m_cam.setHvBiasOff();
-				bool continue_acq = false;
+				continue_acq = false;
 			}
 		} catch (Exception& e) {
 			DEB_ERROR() << "Failed to start acquisition " << DEB_VAR1(rc);
-			bool continue_acq = false;
+			continue_acq = false;
 		}
 		int nbf;
 		m_cam.m_bufferCtrlObj->getNbBuffers(nbf);
 		DEB_TRACE() << DEB_VAR1(nbf);
+		FrameDim frame_dim;
+		m_cam.m_bufferCtrlObj->getFrameDim(frame_dim);
+		int realigned = 0;
+
+		if (continue_acq && batched) {
+			uint64_t frames_acquired;
+			rc = m_cam.m_private->m_hexitec->acquireFrames(m_cam.m_nb_frames, frames_acquired, m_cam.m_timeout);
+			uint32_t high_water_mark, low_water_mark;
+			uint64_t underruns;
+			m_cam.m_private->m_hexitec->getTransferBufferStatistics(high_water_mark, low_water_mark, underruns);
+			DEB_TRACE() << DEB_VAR4(frames_acquired, high_water_mark, low_water_mark, underruns);
+			if (rc != HexitecAPI::NO_ERROR) {
+				if (m_cam.m_trig_mode == ExtGate && m_cam.m_private->m_image_number > 0) {
+					rc = HexitecAPI::NO_ERROR; // just finished the gate & timed out
+				} else if (m_cam.m_trig_mode == ExtGate) {
+					DEB_ERROR() << "External Trigger probably failed " << m_cam.m_private->m_hexitec->getErrorDescription() << " " << DEB_VAR1(rc);
+					trigger_failed = true;
+				} else {
+					DEB_ERROR() << "Acquire error " << m_cam.m_private->m_hexitec->getErrorDescription() << " " << DEB_VAR1(rc);
+				}
+			}
+			continue_acq = false;
+		}
 
+		HexitecAPI::HexitecFrameInfo hw_info;
+		uint64_t last_block_id = 0;
+		bool block_id_valid = false;
+		bool paused = false;
+		uint64_t stream_block_id = 0;
+		uint64_t stream_frame = 0;
+		bool stream_started = false;
+		startBiasRefreshSchedule();
+		uint64_t first_device_time = 0;
+		double first_frame_time = 0.;
+		bool device_time_valid = false;
+		int frame_size = frame_dim.getMemSize();
+		// frames the stream had completed when its buffers were taken back, copied out of
+		// the slots before they are queued again
+		std::deque<std::pair<HexitecAPI::HexitecFrameInfo, std::vector<uint8_t>>> drained;
+		std::vector<uint32_t> drained_indices;
+		std::vector<HexitecAPI::HexitecFrameInfo> drained_info;
 
 	    while (continue_acq && m_cam.m_private->m_acq_started && (!m_cam.m_nb_frames || m_cam.m_private->m_image_number < m_cam.m_nb_frames)) {
 
-			bptr = (uint16_t*) buffer_mgr.getFrameBufferPtr(m_cam.m_private->m_image_number);
-			rc = m_cam.m_private->m_hexitec->retrieveBuffer((uint8_t*)bptr, m_cam.m_timeout);
+			int image_number = m_cam.m_private->m_image_number;
+			bptr = (uint16_t*) buffer_mgr.getFrameBufferPtr(image_number);
+			bool from_stream = drained.empty();
+			if (!from_stream) {
+				hw_info = drained.front().first;
+				rc = HexitecAPI::NO_ERROR;
+			} else if (m_cam.m_zeroCopy) {
+				rc = m_cam.m_private->m_hexitec->retrieveBuffer(bufferIndex, m_cam.m_timeout, hw_info);
+			} else {
+				rc = m_cam.m_private->m_hexitec->retrieveBuffer((uint8_t*)bptr, m_cam.m_timeout, hw_info);
+			}
 			if (rc == HexitecAPI::NO_ERROR) {
+				if (stream_started) {
+					if (HexitecAPI::HexitecApi::blockIdRestarted(stream_block_id, hw_info.BlockId)) {
+						DEB_WARNING() << "Block IDs stepped back, resynchronising "
+								<< DEB_VAR2(stream_block_id, hw_info.BlockId);
+					}
+					stream_frame += HexitecAPI::HexitecApi::blockIdGap(stream_block_id, hw_info.BlockId) + 1;
+				}
+				stream_block_id = hw_info.BlockId;
+				stream_started = true;
+				scheduleBiasRefresh(stream_frame, m_cam.m_private->m_image_number);
 				if (m_cam.getStatus() == Camera::Exposure) {
-					DEB_TRACE() << "Image# " << m_cam.m_private->m_image_number << " acquired";
-					HwFrameInfoType frame_info;
-					frame_info.acq_frame_nb = m_cam.m_private->m_image_number;
-					continue_acq = buffer_mgr.newFrameReady(frame_info);
-					m_cam.m_private->m_image_number++;
+					// frames lost on the way are published as empty frames (valid_pixels = 0)
+					// so the frame numbers stay in step with the detector
+					int gap = block_id_valid ? HexitecAPI::HexitecApi::blockIdGap(last_block_id, hw_info.BlockId) : 0;
+					bool publish = true;
+					if (paused) {
+						// lost around the end of a bias refresh, the frames would have been dropped
+						m_cam.m_discardedFrameCount += gap;
+						gap = 0;
+						paused = false;
+					}
+					if (m_cam.m_nb_frames && image_number + gap >= m_cam.m_nb_frames) {
+						gap = m_cam.m_nb_frames - image_number;
+						publish = false;
+					}
+					last_block_id = hw_info.BlockId;
+					block_id_valid = true;
+
+					// in zero copy mode every other slot is queued on the stream: the slots of
+					// lost frames are taken back before they are written, as are all slots when
+					// skipped or discarded frames shifted the stream with respect to the Lima ring.
+					// Frames already completed in the slots taken back are kept and follow this one
+					bool zero_copy = m_cam.m_zeroCopy && from_stream;
+					bool shifted = zero_copy && (int) bufferIndex != (image_number + gap) % nbf;
+					bool realign = shifted || (zero_copy && gap);
+					int next_index = image_number + gap + 1;
+					if (realign) {
+						if (shifted && !realigned++) {
+							DEB_WARNING() << "Stream out of step with the frame ring, realigning "
+									<< DEB_VAR2(bufferIndex, image_number + gap);
+						}
+						rc = m_cam.m_private->m_hexitec->reclaimBuffers(drained_indices, drained_info);
+						if (rc != HexitecAPI::NO_ERROR) {
+							DEB_ERROR() << "Failed to take the buffers back " << DEB_VAR1(rc);
+							break;
+						}
+						uint64_t block_id = hw_info.BlockId;
+						for (size_t i = 0; i < drained_indices.size(); i++) {
+							uint8_t* frame = (uint8_t*) buffer_mgr.getFrameBufferPtr(drained_indices[i]);
+							drained.emplace_back(drained_info[i], std::vector<uint8_t>(frame, frame + frame_size));
+							next_index += HexitecAPI::HexitecApi::blockIdGap(block_id, drained_info[i].BlockId) + 1;
+							block_id = drained_info[i].BlockId;
+						}
+					}
+					void* src = !from_stream ? drained.front().second.data()
+							: m_cam.m_zeroCopy ? buffer_mgr.getFrameBufferPtr(bufferIndex) : bptr;
+					void* dst = buffer_mgr.getFrameBufferPtr(image_number + gap);
+					if (publish && src != dst) {
+						memcpy(dst, src, frame_size);
+					}
+					// only the last nbf - 1 lost frames still have a slot of their own, the
+					// older ones have been overwritten by the time they are published anyway
+					for (auto i = std::max(0, gap - (nbf - 1)); i < gap; i++) {
+						memset(buffer_mgr.getFrameBufferPtr(image_number + i), 0, frame_size);
+					}
+					if (realign) {
+						rc = m_cam.m_private->m_hexitec->requeueBuffers(next_index % nbf);
+						if (rc != HexitecAPI::NO_ERROR) {
+							DEB_ERROR() << "Failed to queue the buffers " << DEB_VAR1(rc);
+							break;
+						}
+					} else if (zero_copy) {
+						m_cam.m_private->m_hexitec->requeueBuffer(bufferIndex);
+					}
+
+					if (gap) {
+						DEB_WARNING() << "Missing frames " << image_number << " to " << image_number + gap - 1 << " "
+								<< DEB_VAR1(hw_info.BlockId);
+						m_cam.m_missingFrameCount += gap;
+					}
+					for (auto i = 0; i < gap && continue_acq; i++) {
+						HwFrameInfoType frame_info;
+						frame_info.acq_frame_nb = image_number + i;
+						frame_info.valid_pixels = 0;
+						continue_acq = buffer_mgr.newFrameReady(frame_info);
+						m_cam.m_private->m_image_number++;
+					}
+
+					if (publish && continue_acq) {
+						DEB_TRACE() << "Image# " << m_cam.m_private->m_image_number << " acquired";
+						HwFrameInfoType frame_info;
+						frame_info.acq_frame_nb = m_cam.m_private->m_image_number;
+						if (!device_time_valid && m_cam.m_private->m_tickFrequency) {
+							// later frames are timed by the detector clock relative to this one
+							Timestamp start_ts;
+							buffer_mgr.getStartTimestamp(start_ts);
+							first_frame_time = double(Timestamp::now() - start_ts);
+							first_device_time = hw_info.Timestamp;
+							device_time_valid = true;
+						}
+						if (device_time_valid) {
+							frame_info.frame_timestamp = Timestamp(first_frame_time +
+									double(hw_info.Timestamp - first_device_time) / m_cam.m_private->m_tickFrequency);
+						}
+						continue_acq = buffer_mgr.newFrameReady(frame_info);
+						m_cam.m_private->m_image_number++;
+					}
 				} else {
-					std::this_thread::sleep_for(std::chrono::milliseconds(500));
+					// frames taken while the bias is refreshed are dropped, but still drained
+					// at full rate so the pipeline keeps its buffers
+					if (m_cam.m_zeroCopy && from_stream) {
+						m_cam.m_private->m_hexitec->requeueBuffer(bufferIndex);
+					}
+					int gap = block_id_valid ? HexitecAPI::HexitecApi::blockIdGap(last_block_id, hw_info.BlockId) : 0;
+					m_cam.m_discardedFrameCount += gap + 1;
+					last_block_id = hw_info.BlockId;
+					block_id_valid = true;
+					paused = true;
+				}
+				if (!from_stream) {
+					drained.pop_front();
 				}
+			} else if (!m_cam.m_private->m_acq_started) {
+				rc = HexitecAPI::NO_ERROR; // the wait was aborted by stopAcq
+				break;
 			} else if (rc == 27 || rc == 2818) {
 			    m_cam.m_errCount++;
 				DEB_WARNING() << "Skipping frame " << m_cam.m_private->m_hexitec->getErrorDescription() << " " << DEB_VAR1(rc);
@@ -660,8 +1314,14 @@ void Camera::AcqThread::threadFunction() {
 				> (t2 - t1).count() << " nanoseconds";
 
 		m_cam.m_private->m_acq_started = false;
+		{
+			// waits for a bias command in progress, none is started after this
+			std::lock_guard<std::mutex> guard(m_cam.m_private->m_refresh_mutex);
+			m_cam.m_private->m_refresh_request = REFRESH_NONE;
+			m_cam.m_private->m_refresh_by_frames = false;
+		}
 		DEB_ALWAYS() << "Stop acquisition";
-		auto rc2 = m_cam.m_private->m_hexitec->stopAcq();
+		auto rc2 = batched ? HexitecAPI::NO_ERROR : m_cam.m_private->m_hexitec->stopAcq();
 		if (rc2 != HexitecAPI::NO_ERROR) {
 		    DEB_ERROR() << "Failed to stop acquisition " << DEB_VAR1(rc);
 		}
@@ -675,6 +1335,11 @@ void Camera::AcqThread::threadFunction() {
 
 		DEB_ALWAYS() << "Set status to ready";
 		DEB_ALWAYS() << "Skipped frames " << m_cam.m_errCount;
+		DEB_ALWAYS() << "Missing frames " << m_cam.m_missingFrameCount;
+		DEB_ALWAYS() << "Frames discarded during bias refresh " << m_cam.m_discardedFrameCount;
+		if (realigned) {
+			DEB_ALWAYS() << "Stream realigned with the frame ring " << realigned << " times";
+		}
 		if (rc == HexitecAPI::NO_ERROR && rc2 == HexitecAPI::NO_ERROR) {
 			m_cam.setStatus(Camera::Ready);
 		} else {
@@ -683,6 +1348,126 @@ void Camera::AcqThread::threadFunction() {
 	}
 }
 
+//-----------------------------------------------------
+// @brief convert the refresh timing to frames for this acquisition
+//-----------------------------------------------------
+void Camera::AcqThread::startBiasRefreshSchedule() {
+	DEB_MEMBER_FUNCT();
+	auto frames = [this](int millis) {
+		return std::max<uint64_t>(1, (uint64_t) std::ceil(millis / 1000. / m_cam.m_frameTime));
+	};
+	m_refresh_state = REFRESH_EXPOSING;
+	if (m_cam.m_private->m_refresh_by_frames) {
+		m_interval_frames = frames(m_cam.m_biasVoltageRefreshInterval);
+		m_off_frames = frames(m_cam.m_biasVoltageRefreshTime);
+		m_settle_frames = frames(m_cam.m_biasVoltageSettleTime);
+		m_refresh_next = m_interval_frames;
+		DEB_TRACE() << "Bias refresh every " << m_interval_frames << " frames, off for " << m_off_frames
+				<< ", settling for " << m_settle_frames;
+	}
+}
+
+//-----------------------------------------------------
+// @brief advance the bias refresh at a frame boundary, before the frame is handled
+//
+// Pauses the acquisition at the scheduled frame and has the timer thread switch
+// the bias off, back on once the refresh time in frames has passed, and resumes
+// the settle time in frames after the bias is on again. A refresh the timer thread
+// started on the clock, while no frames came in, is followed and recorded as well.
+//-----------------------------------------------------
+void Camera::AcqThread::scheduleBiasRefresh(uint64_t frame, int image_number) {
+	DEB_MEMBER_FUNCT();
+	if (!m_cam.m_private->m_refresh_by_frames) {
+		return;
+	}
+	switch (m_refresh_state) {
+	case REFRESH_EXPOSING:
+		if (m_cam.getStatus() == Camera::Paused) {
+			m_window.startFrame = frame;
+			m_refresh_state = REFRESH_PAUSED;
+		} else if (frame >= m_refresh_next) {
+			m_cam.setStatus(Camera::Paused);
+			DEB_TRACE() << "Paused at frame " << DEB_VAR2(frame, image_number);
+			m_window.startFrame = frame;
+			m_refresh_step = frame + m_off_frames;
+			m_cam.m_private->m_refresh_done = REFRESH_NONE;
+			requestBiasRefresh(REFRESH_REQUEST_BIAS_OFF);
+			m_refresh_state = REFRESH_BIAS_OFF;
+		}
+		break;
+	case REFRESH_BIAS_OFF:
+		if (frame >= m_refresh_step && m_cam.m_private->m_refresh_done == REFRESH_REQUEST_BIAS_OFF) {
+			requestBiasRefresh(REFRESH_REQUEST_BIAS_ON);
+			m_refresh_state = REFRESH_BIAS_ON;
+		}
+		break;
+	case REFRESH_BIAS_ON:
+		if (m_cam.m_private->m_refresh_done == REFRESH_REQUEST_BIAS_ON) {
+			m_refresh_step = frame + m_settle_frames;
+			m_refresh_state = REFRESH_SETTLING;
+		}
+		break;
+	case REFRESH_SETTLING:
+		if (frame >= m_refresh_step) {
+			m_cam.setStatus(Camera::Exposure);
+			m_refresh_state = REFRESH_PAUSED;
+		}
+		break;
+	case REFRESH_PAUSED:
+		break;
+	}
+	// the window closes once exposure resumes, whoever paused it
+	if (m_refresh_state == REFRESH_PAUSED && m_cam.getStatus() == Camera::Exposure) {
+		m_window.endFrame = frame;
+		m_window.imageNumber = image_number;
+		m_refresh_next = frame + m_interval_frames;
+		m_refresh_state = REFRESH_EXPOSING;
+		DEB_TRACE() << "Bias refreshed over frames " << m_window.startFrame << " to " << m_window.endFrame;
+		std::lock_guard<std::mutex> guard(m_cam.m_private->m_refresh_mutex);
+		m_cam.m_private->m_refresh_windows.push_back(m_window);
+		m_cam.m_private->m_last_refresh = Clock::now();
+	}
+}
+
+void Camera::AcqThread::requestBiasRefresh(int request) {
+	std::lock_guard<std::mutex> guard(m_cam.m_private->m_refresh_mutex);
+	m_cam.m_private->m_refresh_request = request;
+	m_cam.m_private->m_refresh_cond.notify_one();
+}
+
+//-----------------------------------------------------
+// @brief apply the cpu affinity and scheduling policy of the acquisition thread
+// to the calling thread. The pipeline buffer handling thread is started by the
+// thread arming the acquisition and inherits both, unless a cpu list of its own
+// is set: the acquisition thread itself, or prepareAcq when pre-arming.
+//-----------------------------------------------------
+void Camera::AcqThread::setScheduling() {
+	DEB_MEMBER_FUNCT();
+	std::vector<int> cpu_list;
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	parseCpuList(m_cam.m_acqThreadCpus, cpu_list);
+	if (cpu_list.empty()) {
+		for (auto cpu = 0; cpu < sysconf(_SC_NPROCESSORS_CONF) && cpu < CPU_SETSIZE; cpu++) {
+			CPU_SET(cpu, &cpus);
+		}
+	}
+	for (auto cpu : cpu_list) {
+		CPU_SET(cpu, &cpus);
+	}
+	auto rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	if (rc != 0) {
+		DEB_WARNING() << "Failed to set acquisition thread affinity " << strerror(rc);
+	}
+
+	struct sched_param param;
+	param.sched_priority = m_cam.m_acqThreadPriority;
+	rc = pthread_setschedparam(pthread_self(), m_cam.m_acqThreadPriority ? SCHED_FIFO : SCHED_OTHER, &param);
+	if (rc != 0) {
+		DEB_WARNING() << "Failed to set acquisition thread priority " << strerror(rc);
+	}
+}
+
 //-----------------------------------------------------
 // timer thread
 //-----------------------------------------------------
@@ -714,25 +1499,220 @@ void Camera::TimerThread::threadFunction() {
 		if (m_cam.m_private->m_quit)
 			return;
 
+		if (m_cam.m_private->m_refresh_by_frames) {
+			// the acquisition loop requests the bias commands at frame boundaries, the
+			// clock only takes over when no frames arrive to schedule the refresh
+			auto period = std::chrono::milliseconds(2 * m_cam.m_biasVoltageRefreshInterval
+					+ m_cam.m_biasVoltageRefreshTime + m_cam.m_biasVoltageSettleTime);
+			std::unique_lock<std::mutex> lock(m_cam.m_private->m_refresh_mutex);
+			m_cam.m_private->m_refresh_cond.wait_for(lock, std::chrono::milliseconds(100), [this] {
+				return m_cam.m_private->m_refresh_request != REFRESH_NONE;
+			});
+			int request = m_cam.m_private->m_refresh_request;
+			m_cam.m_private->m_refresh_request = REFRESH_NONE;
+			if (!m_cam.m_private->m_acq_started) {
+				continue;
+			}
+			if (request == REFRESH_REQUEST_BIAS_OFF) {
+				m_cam.setHvBiasOff();
+				m_cam.m_private->m_refresh_done = request;
+			} else if (request == REFRESH_REQUEST_BIAS_ON) {
+				m_cam.setHvBiasOn();
+				m_cam.m_private->m_refresh_done = request;
+			} else if (Clock::now() - m_cam.m_private->m_last_refresh > period && m_cam.getStatus() == Camera::Exposure) {
+				m_cam.m_private->m_last_refresh = Clock::now();
+				lock.unlock();
+				DEB_WARNING() << "No frames to schedule the bias refresh on, refreshing on the clock";
+				refreshOnClock();
+			}
+			continue;
+		}
+
 		std::this_thread::sleep_for(std::chrono::milliseconds(m_cam.m_biasVoltageRefreshInterval));
 		if (m_cam.m_private->m_acq_started) {
-			m_cam.setStatus(Camera::Paused);
-			DEB_TRACE() << "Paused at frame " << DEB_VAR1(m_cam.m_private->m_image_number);
-			m_cam.setHvBiasOff();
-		if (m_cam.m_private->m_acq_started)
-			std::this_thread::sleep_for(std::chrono::milliseconds(m_cam.m_biasVoltageRefreshTime));
-        if (m_cam.m_private->m_acq_started)
-			m_cam.setHvBiasOn();
-			std::this_thread::sleep_for(std::chrono::milliseconds(m_cam.m_biasVoltageSettleTime));
-	    if (m_cam.m_private->m_acq_started)
-			m_cam.setStatus(Camera::Exposure);
-			DEB_TRACE() << "Acq status in timer after restart " << DEB_VAR1(m_cam.m_private->m_status);
+			refreshOnClock();
 		} else {
             m_cam.setHvBiasOff();
 		}
 	}
 }
 
+void Camera::TimerThread::refreshOnClock() {
+	DEB_MEMBER_FUNCT();
+	m_cam.setStatus(Camera::Paused);
+	DEB_TRACE() << "Paused at frame " << DEB_VAR1(m_cam.m_private->m_image_number);
+	m_cam.setHvBiasOff();
+	if (m_cam.m_private->m_acq_started)
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_cam.m_biasVoltageRefreshTime));
+	if (m_cam.m_private->m_acq_started)
+		m_cam.setHvBiasOn();
+	std::this_thread::sleep_for(std::chrono::milliseconds(m_cam.m_biasVoltageSettleTime));
+	if (m_cam.m_private->m_acq_started)
+		m_cam.setStatus(Camera::Exposure);
+	DEB_TRACE() << "Acq status in timer after restart " << DEB_VAR1(m_cam.m_private->m_status);
+}
+
+//-----------------------------------------------------
+// statistics thread
+//-----------------------------------------------------
+Camera::StatisticsThread::StatisticsThread(Camera& cam) :
+		m_cam(cam), m_quit(false) {
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+Camera::StatisticsThread::~StatisticsThread() {
+	DEB_DESTRUCTOR();
+	AutoMutex lock(m_cond.mutex());
+	m_quit = true;
+	m_cond.broadcast();
+	lock.unlock();
+	DEB_TRACE()  << "Waiting for the statistics thread to be done (joining the main thread)";
+	join();
+}
+
+// Samples the stream counters every m_statisticsInterval, away from the acquisition loop
+void Camera::StatisticsThread::threadFunction() {
+	DEB_MEMBER_FUNCT();
+	int last_image_number = m_cam.m_private->m_image_number;
+	auto last = Clock::now();
+
+	AutoMutex lock(m_cond.mutex());
+	while (!m_quit) {
+		m_cond.wait(m_cam.m_statisticsInterval / 1000.);
+		if (m_quit)
+			break;
+		lock.unlock();
+
+		HexitecAPI::HexitecStreamStatistics hw_stats;
+		auto rc = m_cam.m_private->m_hexitec->getStreamStatistics(hw_stats);
+		int image_number = m_cam.m_private->m_image_number;
+		auto now = Clock::now();
+		double elapsed = std::chrono::duration<double>(now - last).count();
+		if (rc == HexitecAPI::NO_ERROR) {
+			StreamStatistics stats;
+			stats.bandwidth = hw_stats.Bandwidth;
+			stats.acquisitionRate = hw_stats.AcquisitionRate;
+			// the image counter restarts with every acquisition
+			stats.frameRate = (image_number >= last_image_number && elapsed > 0) ?
+					(image_number - last_image_number) / elapsed : 0.;
+			stats.blockCount = hw_stats.BlockCount;
+			stats.blocksDropped = hw_stats.BlocksDropped;
+			stats.blockIdsMissing = hw_stats.BlockIDsMissing;
+			stats.resendGroupRequested = hw_stats.ResendGroupRequested;
+			stats.resendPacketRequested = hw_stats.ResendPacketRequested;
+			stats.pipelineQueueDepth = hw_stats.PipelineQueueDepth;
+			std::lock_guard<std::mutex> guard(m_cam.m_private->m_statistics_mutex);
+			m_cam.m_private->m_stream_statistics = stats;
+		} else {
+			DEB_TRACE() << "Failed to read the stream statistics " << DEB_VAR1(rc);
+		}
+		last_image_number = image_number;
+		last = now;
+
+		lock.lock();
+	}
+}
+
+//-----------------------------------------------------
+// telemetry thread
+//-----------------------------------------------------
+Camera::TelemetryThread::TelemetryThread(Camera& cam) :
+		m_cam(cam), m_quit(false) {
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+Camera::TelemetryThread::~TelemetryThread() {
+	DEB_DESTRUCTOR();
+	AutoMutex lock(m_cond.mutex());
+	m_quit = true;
+	m_cond.broadcast();
+	lock.unlock();
+	DEB_TRACE()  << "Waiting for the telemetry thread to be done (joining the main thread)";
+	join();
+}
+
+// Reads the environment and operating values every m_telemetryInterval, 0 pauses sampling
+void Camera::TelemetryThread::threadFunction() {
+	DEB_MEMBER_FUNCT();
+
+	AutoMutex lock(m_cond.mutex());
+	while (!m_quit) {
+		int interval = m_cam.m_telemetryInterval;
+		m_cond.wait((interval > 0 ? interval : 1000) / 1000.);
+		if (m_quit)
+			break;
+		if (m_cam.m_telemetryInterval <= 0)
+			continue;
+		lock.unlock();
+
+		TelemetrySample sample;
+		int frame = m_cam.m_private->m_image_number;
+		auto rc = m_cam.m_private->m_hexitec->readEnvironmentValues(sample.env.humidity, sample.env.ambientTemperature,
+				sample.env.asicTemperature, sample.env.adcTemperature, sample.env.ntcTemperature);
+		if (rc == HexitecAPI::NO_ERROR) {
+			rc = m_cam.m_private->m_hexitec->readOperatingValues(sample.opval.v3_3, sample.opval.hvMon, sample.opval.hvOut,
+					sample.opval.v1_2, sample.opval.v1_8, sample.opval.v3, sample.opval.v2_5, sample.opval.v3_3ln,
+					sample.opval.v1_65ln, sample.opval.v1_8ana, sample.opval.v3_8ana, sample.opval.peltierCurrent,
+					sample.opval.ntcTemperature);
+		}
+		if (rc == HexitecAPI::NO_ERROR) {
+			sample.timestamp = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+			m_cam.m_private->m_telemetry->push(sample);
+			if (m_cam.m_private->m_acq_started) {
+				m_cam.writeTelemetryRecord(sample, frame);
+			}
+		} else {
+			DEB_TRACE() << "Failed to read the telemetry " << DEB_VAR1(rc);
+		}
+
+		lock.lock();
+	}
+}
+
+//-----------------------------------------------------
+// transfer buffer callback
+//-----------------------------------------------------
+Camera::TransferBufferCb::TransferBufferCb(Camera& cam) : m_cam(cam) {}
+
+Camera::TransferBufferCb::~TransferBufferCb() {}
+
+void Camera::TransferBufferCb::bufferReady(uint8_t* transferBuffer, uint32_t frameCount) {
+	DEB_MEMBER_FUNCT();
+	if (!m_cam.m_private->m_acq_started) {
+		m_cam.m_private->m_hexitec->stopAcquisition();
+		return;
+	}
+	if (m_cam.getStatus() != Camera::Exposure) {
+		// frames taken while the bias is refreshed are dropped
+		m_cam.m_discardedFrameCount += frameCount;
+		return;
+	}
+	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj->getBuffer();
+	FrameDim frame_dim;
+	m_cam.m_bufferCtrlObj->getFrameDim(frame_dim);
+	int frame_size = frame_dim.getMemSize();
+	int first = m_cam.m_private->m_image_number;
+	int count = frameCount;
+	if (m_cam.m_nb_frames && first + count > m_cam.m_nb_frames) {
+		count = m_cam.m_nb_frames - first;
+	}
+	// copy the whole batch before announcing it, so Lima gets the frames back to back
+	for (auto i = 0; i < count; i++) {
+		memcpy(buffer_mgr.getFrameBufferPtr(first + i), transferBuffer + i * frame_size, frame_size);
+	}
+	bool continue_acq = true;
+	for (auto i = 0; i < count && continue_acq; i++) {
+		HwFrameInfoType frame_info;
+		frame_info.acq_frame_nb = first + i;
+		continue_acq = buffer_mgr.newFrameReady(frame_info);
+		m_cam.m_private->m_image_number++;
+	}
+	DEB_TRACE() << "Images# " << first << " to " << m_cam.m_private->m_image_number - 1 << " acquired";
+	if (!continue_acq) {
+		m_cam.m_private->m_hexitec->stopAcquisition();
+	}
+}
+
 //-----------------------------------------------------
 // task event callback
 //-----------------------------------------------------
@@ -750,11 +1730,77 @@ void Camera::TaskEventCb::finished(Data& data) {
 // Hexitec specific stuff
 //-----------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// @brief get the stream statistics of the last sampling interval
+//-----------------------------------------------------------------------------
+void Camera::getStreamStatistics(StreamStatistics& stats) {
+	std::lock_guard<std::mutex> guard(m_private->m_statistics_mutex);
+	stats = m_private->m_stream_statistics;
+}
+
+void Camera::setStatisticsInterval(int millis) {
+	DEB_MEMBER_FUNCT();
+	if (millis <= 0) {
+		THROW_HW_ERROR(InvalidValue) << "Statistics interval must be positive " << DEB_VAR1(millis);
+	}
+	m_statisticsInterval = millis;
+}
+
+void Camera::getStatisticsInterval(int& millis) {
+	millis = m_statisticsInterval;
+}
+
+//-----------------------------------------------------------------------------
+// @brief memory in MB shared by the pipeline and the Lima ring, 0 to use bufferCount
+//-----------------------------------------------------------------------------
+void Camera::setBufferMemoryBudget(int megabytes) {
+	DEB_MEMBER_FUNCT();
+	if (megabytes < 0) {
+		THROW_HW_ERROR(InvalidValue) << "Memory budget must not be negative " << DEB_VAR1(megabytes);
+	}
+	m_bufferMemoryBudget = megabytes;
+}
+
+void Camera::getBufferMemoryBudget(int& megabytes) {
+	megabytes = m_bufferMemoryBudget;
+}
+
+//-----------------------------------------------------------------------------
+// @brief time in ms the Lima ring has to cover when saving stalls, 0 to use bufferCount
+//-----------------------------------------------------------------------------
+void Camera::setStallTolerance(int millis) {
+	DEB_MEMBER_FUNCT();
+	if (millis < 0) {
+		THROW_HW_ERROR(InvalidValue) << "Stall tolerance must not be negative " << DEB_VAR1(millis);
+	}
+	m_stallTolerance = millis;
+}
+
+void Camera::getStallTolerance(int& millis) {
+	millis = m_stallTolerance;
+}
+
+//-----------------------------------------------------------------------------
+// @brief buffer depths in use since the last prepareAcq
+//-----------------------------------------------------------------------------
+void Camera::getPipelineBufferCount(int& count) {
+	count = m_private->m_pipelineBufferCount;
+}
+
+void Camera::getLimaBufferCount(int& count) {
+	count = m_private->m_limaBufferCount;
+}
+
 //-----------------------------------------------------------------------------
 // @brief get environmental values
 //-----------------------------------------------------------------------------
 void Camera::getEnvironmentalValues(Environment& env) {
 	DEB_MEMBER_FUNCT();
+	TelemetrySample sample;
+	if (getRecentTelemetry(sample)) {
+		env = sample.env;
+		return;
+	}
 	auto rc = m_private->m_hexitec->readEnvironmentValues(env.humidity, env.ambientTemperature, env.asicTemperature, env.adcTemperature,
 			env.ntcTemperature);
 	if (rc != HexitecAPI::NO_ERROR) {
@@ -767,6 +1813,11 @@ void Camera::getEnvironmentalValues(Environment& env) {
 //-----------------------------------------------------------------------------
 void Camera::getOperatingValues(OperatingValues& opval) {
 	DEB_MEMBER_FUNCT();
+	TelemetrySample sample;
+	if (getRecentTelemetry(sample)) {
+		opval = sample.opval;
+		return;
+	}
 	auto rc = m_private->m_hexitec->readOperatingValues(opval.v3_3, opval.hvMon, opval.hvOut, opval.v1_2, opval.v1_8, opval.v3, opval.v2_5,
 			opval.v3_3ln, opval.v1_65ln, opval.v1_8ana, opval.v3_8ana, opval.peltierCurrent, opval.ntcTemperature);
 	if (rc != HexitecAPI::NO_ERROR) {
@@ -774,6 +1825,113 @@ void Camera::getOperatingValues(OperatingValues& opval) {
 	}
 }
 
+//-----------------------------------------------------------------------------
+// @brief latest sample if the sampler is running and has kept up, else read directly
+//-----------------------------------------------------------------------------
+bool Camera::getRecentTelemetry(TelemetrySample& sample) {
+	int interval = m_telemetryInterval;
+	if (interval <= 0 || !m_private->m_telemetry->latest(sample)) {
+		return false;
+	}
+	double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	return now - sample.timestamp < 2 * interval / 1000.;
+}
+
+/**
+ * Set the telemetry sampling interval
+ * @param[in] millis time in milliseconds, 0 stops sampling and reads the values on every request
+ */
+void Camera::setTelemetryInterval(int millis) {
+	DEB_MEMBER_FUNCT();
+	if (millis < 0) {
+		THROW_HW_ERROR(InvalidValue) << "Telemetry interval must not be negative " << DEB_VAR1(millis);
+	}
+	m_telemetryInterval = millis;
+}
+
+void Camera::getTelemetryInterval(int& millis) {
+	millis = m_telemetryInterval;
+}
+
+//-----------------------------------------------------------------------------
+// @brief sample taken age intervals ago, 0 is the latest
+//-----------------------------------------------------------------------------
+void Camera::getTelemetrySample(int age, TelemetrySample& sample) {
+	DEB_MEMBER_FUNCT();
+	std::vector<TelemetrySample> samples;
+	if (age < 0 || m_private->m_telemetry->history(samples, age + 1) <= (size_t)age) {
+		THROW_HW_ERROR(InvalidValue) << "No telemetry sample of that age " << DEB_VAR1(age);
+	}
+	sample = samples.front();
+}
+
+//-----------------------------------------------------------------------------
+// @brief samples of the last seconds, oldest first
+//-----------------------------------------------------------------------------
+void Camera::getTelemetryHistory(double seconds, std::vector<TelemetrySample>& samples) {
+	double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	m_private->m_telemetry->history(samples, TELEMETRY_HISTORY_SIZE);
+	auto first = std::find_if(samples.begin(), samples.end(),
+			[&](const TelemetrySample& sample) { return sample.timestamp >= now - seconds; });
+	samples.erase(samples.begin(), first);
+}
+
+/**
+ * Record the telemetry samples taken during acquisitions to a file, to correlate them with
+ * the frames. Records are appended to an existing file. Each one holds the sample time, the
+ * acquisition and frame number at that time and the 18 values, see TelemetryRecord.
+ * @param[in] filename file to append to, empty to stop recording
+ */
+void Camera::setTelemetryFile(const std::string& filename) {
+	DEB_MEMBER_FUNCT();
+	std::lock_guard<std::mutex> guard(m_private->m_telemetry_file_mutex);
+	if (m_private->m_telemetry_file.is_open()) {
+		m_private->m_telemetry_file.close();
+	}
+	m_private->m_telemetry_filename = filename;
+	if (filename.empty()) {
+		return;
+	}
+	m_private->m_telemetry_file.open(filename, std::ios::binary | std::ios::app);
+	if (!m_private->m_telemetry_file) {
+		m_private->m_telemetry_filename.clear();
+		THROW_HW_ERROR(Error) << "Failed to open the telemetry file " << DEB_VAR1(filename);
+	}
+	m_private->m_telemetry_file.seekp(0, std::ios::end);
+	if (m_private->m_telemetry_file.tellp() == 0) {
+		TelemetryFileHeader header = { {'H', 'X', 'T', 'L'}, 1, sizeof(TelemetryRecord), 18 };
+		m_private->m_telemetry_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_private->m_telemetry_file.flush();
+	}
+}
+
+void Camera::getTelemetryFile(std::string& filename) {
+	std::lock_guard<std::mutex> guard(m_private->m_telemetry_file_mutex);
+	filename = m_private->m_telemetry_filename;
+}
+
+void Camera::writeTelemetryRecord(const TelemetrySample& sample, int frame) {
+	DEB_MEMBER_FUNCT();
+	std::lock_guard<std::mutex> guard(m_private->m_telemetry_file_mutex);
+	if (!m_private->m_telemetry_file.is_open()) {
+		return;
+	}
+	TelemetryRecord record;
+	record.timestamp = sample.timestamp;
+	record.acquisition = m_private->m_acq_number;
+	record.frame = frame;
+	static_assert(sizeof(Environment) + sizeof(OperatingValues) == sizeof(record.values), "telemetry values");
+	memcpy(record.values, &sample.env, sizeof(Environment));
+	memcpy(record.values + sizeof(Environment) / sizeof(double), &sample.opval, sizeof(OperatingValues));
+	// flushed per record, a crash loses at most the sample in flight
+	m_private->m_telemetry_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	m_private->m_telemetry_file.flush();
+	if (!m_private->m_telemetry_file) {
+		DEB_WARNING() << "Failed to write the telemetry file, recording stopped";
+		m_private->m_telemetry_file.close();
+	}
+}
+
 /**
  * Set dark current collection timeout
  * @param[in] timeout time in milliseconds
@@ -804,6 +1962,72 @@ void Camera::collectOffsetValues() {
     setHvBiasOff();
 }
 
+//-----------------------------------------------------------------------------
+// @brief refresh the shadow of the detector configuration registers
+//-----------------------------------------------------------------------------
+void Camera::resyncRegisters() {
+	DEB_MEMBER_FUNCT();
+	auto rc = m_private->m_hexitec->resync();
+	if (rc != HexitecAPI::NO_ERROR) {
+		THROW_HW_ERROR(Error) << "Failed to read the configuration registers " << DEB_VAR1(rc);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// @brief read shadowed registers from the detector as well and fail on a stale shadow
+//-----------------------------------------------------------------------------
+void Camera::setRegisterCoherenceCheck(bool enable) {
+	m_private->m_hexitec->setRegisterCoherenceCheck(enable);
+	m_registerCoherenceCheck = enable;
+}
+
+void Camera::getRegisterCoherenceCheck(bool& enable) {
+	enable = m_registerCoherenceCheck;
+}
+
+/**
+ * Bias and trigger commands are always sent ahead of telemetry reads, this bounds how
+ * long a telemetry read may wait behind them before it fails
+ * @param[in] deadline time in milliseconds, 0 waits forever
+ */
+void Camera::setTelemetryDeadline(int deadline) {
+	m_private->m_hexitec->setSerialDeadline(HexitecAPI::SERIAL_PRIORITY_TELEMETRY, std::max(deadline, 0));
+	m_telemetryDeadline = std::max(deadline, 0);
+}
+
+void Camera::getTelemetryDeadline(int& deadline) {
+	deadline = m_telemetryDeadline;
+}
+
+//-----------------------------------------------------------------------------
+// @brief Serial transactions per command code since the last reset
+//
+// Queue is the time a command waited for the port, wire the time spent on the
+// port itself. Percentiles come from log buckets and are exact to 12.5 %.
+//-----------------------------------------------------------------------------
+void Camera::getSerialStatistics(std::string& report) {
+	std::map<uint8_t, HexitecAPI::SerialStatistics> statistics;
+	std::ostringstream os;
+
+	m_private->m_hexitec->getSerialStatistics(statistics);
+	os << "code   count errors  written     read | queue us    p50    p99    max | wire us    p50    p99      max  total ms\n";
+	for (auto& entry : statistics) {
+		const HexitecAPI::SerialStatistics& s = entry.second;
+		os << "0x" << std::hex << std::setw(2) << std::setfill('0') << int(entry.first) << std::dec << std::setfill(' ')
+				<< std::setw(8) << s.count << std::setw(7) << s.errors
+				<< std::setw(9) << s.bytesWritten << std::setw(9) << s.bytesRead << " |         "
+				<< std::setw(7) << s.queueTime.percentile(0.5) << std::setw(7) << s.queueTime.percentile(0.99)
+				<< std::setw(7) << s.queueTime.max() << " |        "
+				<< std::setw(7) << s.wireTime.percentile(0.5) << std::setw(7) << s.wireTime.percentile(0.99)
+				<< std::setw(9) << s.wireTime.max() << std::setw(10) << s.wireTime.sum() / 1000 << "\n";
+	}
+	report = os.str();
+}
+
+void Camera::resetSerialStatistics() {
+	m_private->m_hexitec->resetSerialStatistics();
+}
+
 void Camera::setType(ProcessType type) {
 	m_processType = type;
 }
@@ -844,6 +2068,44 @@ void Camera::getHighThreshold(int& threshold) {
 	threshold = m_highThreshold;
 }
 
+// pixels above the event threshold are hits for the charge sharing correction
+void Camera::setEventThreshold(int threshold) {
+	DEB_MEMBER_FUNCT();
+	if (threshold < 0) {
+		THROW_HW_ERROR(InvalidValue) << "Event threshold must not be negative " << DEB_VAR1(threshold);
+	}
+	m_eventThreshold = threshold;
+}
+
+void Camera::getEventThreshold(int& threshold) {
+	threshold = m_eventThreshold;
+}
+
+// clusters summing to this energy or more are pile up and left uncorrected
+void Camera::setEventMaxEnergy(int energy) {
+	DEB_MEMBER_FUNCT();
+	if (energy <= 0) {
+		THROW_HW_ERROR(InvalidValue) << "Event max energy must be positive " << DEB_VAR1(energy);
+	}
+	m_eventMaxEnergy = energy;
+}
+
+void Camera::getEventMaxEnergy(int& energy) {
+	energy = m_eventMaxEnergy;
+}
+
+void Camera::setChargeSharingKernel(int size) {
+	DEB_MEMBER_FUNCT();
+	if (size != 3 && size != 5) {
+		THROW_HW_ERROR(InvalidValue) << "Charge sharing kernel must be 3 or 5 " << DEB_VAR1(size);
+	}
+	m_chargeSharingKernel = size;
+}
+
+void Camera::getChargeSharingKernel(int& size) {
+	size = m_chargeSharingKernel;
+}
+
 void Camera::setHvBiasOn() {
 	DEB_MEMBER_FUNCT();
 	auto rc = m_private->m_hexitec->setHvBiasOn(true);
@@ -921,3 +2183,259 @@ void Camera::getFramesPerTrigger(int& nframes) {
 void Camera::getSkippedFrameCount(int& count) {
     count = m_errCount;
 }
+
+/**
+ * Frames lost between the detector and the host in the last acquisition, detected
+ * from gaps in the block IDs and published as empty frames.
+ */
+void Camera::getMissingFrameCount(int& count) {
+    count = m_missingFrameCount;
+}
+
+/**
+ * Frames the detector delivered while the bias was being refreshed in the last
+ * acquisition. They are read from the stream and dropped, not published.
+ */
+void Camera::getDiscardedFrameCount(int& count) {
+    count = m_discardedFrameCount;
+}
+
+//-----------------------------------------------------------------------------
+// @brief bias refresh windows of the current or last acquisition
+//
+// Frames from startFrame up to endFrame (exclusive) were taken while the bias was
+// off or settling and are not published. Only acquisitions retrieving frame by
+// frame schedule the refresh in frames, batched ones refresh on the clock.
+//-----------------------------------------------------------------------------
+void Camera::getBiasRefreshCount(int& count) {
+	std::lock_guard<std::mutex> guard(m_private->m_refresh_mutex);
+	count = m_private->m_refresh_windows.size();
+}
+
+void Camera::getBiasRefreshWindow(int index, BiasRefreshWindow& window) {
+	DEB_MEMBER_FUNCT();
+	std::lock_guard<std::mutex> guard(m_private->m_refresh_mutex);
+	if (index < 0 || index >= (int) m_private->m_refresh_windows.size()) {
+		THROW_HW_ERROR(InvalidValue) << "No bias refresh window " << DEB_VAR1(index);
+	}
+	window = m_private->m_refresh_windows[index];
+}
+
+/**
+ * Receive frames directly into the Lima buffers instead of copying them out of the
+ * Pleora pipeline. Takes effect at the next prepareAcq.
+ */
+void Camera::setZeroCopy(bool enable) {
+    m_zeroCopy = enable;
+}
+
+void Camera::getZeroCopy(bool& enable) {
+    enable = m_zeroCopy;
+}
+
+/**
+ * Deliver frames in batches of nframes through the transfer buffers of the SDK
+ * acquisition loop instead of retrieving them one by one. 0 selects the single
+ * frame path. Takes effect at the next prepareAcq.
+ */
+void Camera::setTransferBufferFrameCount(int nframes) {
+    DEB_MEMBER_FUNCT();
+    if (nframes < 0) {
+        THROW_HW_ERROR(InvalidValue) << "Transfer buffer frame count must not be negative " << DEB_VAR1(nframes);
+    }
+    m_transferBufferFrameCount = nframes;
+}
+
+void Camera::getTransferBufferFrameCount(int& nframes) {
+    nframes = m_transferBufferFrameCount;
+}
+
+/**
+ * Pin the acquisition thread to the given cores, e.g. "2,4-5". An empty list
+ * allows all cores. Takes effect at the next acquisition.
+ */
+void Camera::setAcqThreadCpus(const std::string& cpus) {
+    DEB_MEMBER_FUNCT();
+    std::vector<int> cpu_list;
+    if (!parseCpuList(cpus, cpu_list)) {
+        THROW_HW_ERROR(InvalidValue) << "Invalid cpu list " << DEB_VAR1(cpus);
+    }
+    m_acqThreadCpus = cpus;
+}
+
+void Camera::getAcqThreadCpus(std::string& cpus) {
+    cpus = m_acqThreadCpus;
+}
+
+/**
+ * Run the acquisition thread SCHED_FIFO with the given priority, 0 for the default
+ * time sharing policy. Needs CAP_SYS_NICE. Takes effect at the next acquisition.
+ */
+void Camera::setAcqThreadPriority(int priority) {
+    DEB_MEMBER_FUNCT();
+    if (priority != 0 && (priority < sched_get_priority_min(SCHED_FIFO) || priority > sched_get_priority_max(SCHED_FIFO))) {
+        THROW_HW_ERROR(InvalidValue) << "Invalid SCHED_FIFO priority " << DEB_VAR1(priority);
+    }
+    m_acqThreadPriority = priority;
+}
+
+void Camera::getAcqThreadPriority(int& priority) {
+    priority = m_acqThreadPriority;
+}
+
+/**
+ * Pin the Pleora buffer handling thread to the given cores. An empty list leaves it
+ * on the cores of the acquisition thread. Takes effect at the next acquisition.
+ */
+void Camera::setBufferHandlingThreadCpus(const std::string& cpus) {
+    DEB_MEMBER_FUNCT();
+    std::vector<int> cpu_list;
+    if (!parseCpuList(cpus, cpu_list)) {
+        THROW_HW_ERROR(InvalidValue) << "Invalid cpu list " << DEB_VAR1(cpus);
+    }
+    m_private->m_hexitec->setBufferHandlingThreadAffinity(cpu_list);
+    m_bufferHandlingThreadCpus = cpus;
+}
+
+void Camera::getBufferHandlingThreadCpus(std::string& cpus) {
+    cpus = m_bufferHandlingThreadCpus;
+}
+
+void Camera::setBufferHandlingThreadPriority(int priority) {
+    DEB_MEMBER_FUNCT();
+    auto rc = m_private->m_hexitec->setBufferHandlingThreadPriority(priority);
+    if (rc != HexitecAPI::NO_ERROR) {
+        THROW_HW_ERROR(Error) << "Failed to set the buffer handling thread priority " << DEB_VAR1(rc);
+    }
+}
+
+void Camera::getBufferHandlingThreadPriority(int& priority) {
+    DEB_MEMBER_FUNCT();
+    int32_t value = 0;
+    auto rc = m_private->m_hexitec->getBufferHandlingThreadPriority(value);
+    if (rc != HexitecAPI::NO_ERROR) {
+        THROW_HW_ERROR(Error) << "Failed to get the buffer handling thread priority " << DEB_VAR1(rc);
+    }
+    priority = value;
+}
+
+/**
+ * Back the Lima frame ring and the transfer buffers with 2 MB pages. The transfer
+ * buffers use reserved hugetlb pages when available, otherwise, like the Lima ring,
+ * transparent hugepages are advised. Takes effect at the next prepareAcq.
+ */
+void Camera::setHugePages(bool enable) {
+    m_hugePages = enable;
+}
+
+void Camera::getHugePages(bool& enable) {
+    enable = m_hugePages;
+}
+
+/**
+ * Lock the frame buffers in memory so they are never swapped out. Limited by
+ * RLIMIT_MEMLOCK. Takes effect at the next prepareAcq.
+ */
+void Camera::setLockBuffers(bool enable) {
+    m_lockBuffers = enable;
+}
+
+void Camera::getLockBuffers(bool& enable) {
+    enable = m_lockBuffers;
+}
+
+/**
+ * Bind the frame buffers to the NUMA node of the network interface the detector
+ * is reached through. Takes effect at the next prepareAcq.
+ */
+void Camera::setNumaBinding(bool enable) {
+    m_numaBinding = enable;
+}
+
+void Camera::getNumaBinding(bool& enable) {
+    enable = m_numaBinding;
+}
+
+/**
+ * Allocation the frame buffers actually got at the last prepareAcq.
+ */
+void Camera::getBufferAllocation(std::string& allocation) {
+    allocation = m_private->m_bufferAllocation;
+}
+
+/**
+ * Do the reset, pipeline start and stream enable in prepareAcq so that the
+ * acquisition thread only has to send the start command. Not used with
+ * transfer buffers, where acquireFrames starts the detector itself.
+ */
+void Camera::setPreArm(bool enable) {
+    m_preArm = enable;
+}
+
+void Camera::getPreArm(bool& enable) {
+    enable = m_preArm;
+}
+
+/**
+ * Time in ms from startAcq, or from the end of the bias settle wait if that came
+ * later, until the start command was sent for the last acquisition; not measured
+ * with transfer buffers.
+ */
+void Camera::getStartLatency(double& millis) {
+    millis = m_startLatency;
+}
+
+/**
+ * prepareAcq waits for hvOut to come within this many volts of the bias set point,
+ * for at most the bias settle time.
+ */
+void Camera::setBiasSettleTolerance(double volts) {
+    m_biasSettleTolerance = std::fabs(volts);
+}
+
+void Camera::getBiasSettleTolerance(double& volts) {
+    volts = m_biasSettleTolerance;
+}
+
+/**
+ * Time in ms the HV bias took to settle in the last prepareAcq.
+ */
+void Camera::getBiasSettleTime(double& millis) {
+    millis = m_biasSettleTime;
+}
+
+//-----------------------------------------------------------------------------
+// @brief wait until the measured HV output has reached the bias set point
+//
+// Polls the operating values until two readings in a row are within the
+// tolerance, for at most m_biasVoltageSettleTime ms. Running out of time is
+// only reported, the acquisition then starts as it would without the check.
+//-----------------------------------------------------------------------------
+void Camera::waitForBiasSettle() {
+	DEB_MEMBER_FUNCT();
+	auto start = Clock::now();
+	auto deadline = start + std::chrono::milliseconds(m_biasVoltageSettleTime);
+	int target;
+	int settled = 0;
+	OperatingValues opval = OperatingValues();
+
+	m_private->m_hexitec->getBiasVoltage(target);
+	while (settled < 2) {
+		if (Clock::now() >= deadline) {
+			DEB_WARNING() << "HV bias not settled after " << m_biasVoltageSettleTime << " ms " << DEB_VAR2(opval.hvOut, target);
+			break;
+		}
+		auto rc = m_private->m_hexitec->readOperatingValues(opval.v3_3, opval.hvMon, opval.hvOut, opval.v1_2, opval.v1_8, opval.v3,
+				opval.v2_5, opval.v3_3ln, opval.v1_65ln, opval.v1_8ana, opval.v3_8ana, opval.peltierCurrent, opval.ntcTemperature);
+		if (rc != HexitecAPI::NO_ERROR) {
+			settled = 0;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		} else if (std::fabs(opval.hvOut - target) <= m_biasSettleTolerance) {
+			settled++;
+		} else {
+			settled = 0;
+		}
+	}
+	m_biasSettleTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	DEB_TRACE() << "HV bias at " << opval.hvOut << " V after " << m_biasSettleTime << " ms";
+}
@@ -24,6 +24,7 @@
 #include "HexitecCamera.h"
 #include "HexitecDetInfoCtrlObj.h"
 #include "HexitecSyncCtrlObj.h"
+#include "HexitecReconstructionCtrlObj.h"
 
 
 using namespace lima;
@@ -38,9 +39,11 @@ Interface::Interface(Camera& cam) : m_cam(cam) {
 	DEB_CONSTRUCTOR();
 	m_det_info = new DetInfoCtrlObj(cam);
 	m_sync = new SyncCtrlObj(cam);
+	m_reconstruction = new ReconstructionCtrlObj(cam);
 
 	m_cap_list.push_back(HwCap(m_det_info));
 	m_cap_list.push_back(HwCap(m_sync));
+	m_cap_list.push_back(HwCap(m_reconstruction));
 
 	HwBufferCtrlObj *buffer = m_cam.getBufferCtrlObj();
 	m_cap_list.push_back(HwCap(buffer));
@@ -55,6 +58,7 @@ Interface::~Interface() {
 	DEB_DESTRUCTOR();
 	delete m_det_info;
 	delete m_sync;
+	delete m_reconstruction;
 }
 
 //-----------------------------------------------------
@@ -79,6 +83,7 @@ void Interface::reset(ResetLevel reset_level) {
 //-----------------------------------------------------
 void Interface::prepareAcq() {
 	DEB_MEMBER_FUNCT();
+	m_reconstruction->prepareAcq();
 	m_cam.prepareAcq();
 }
 
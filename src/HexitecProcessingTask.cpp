@@ -0,0 +1,109 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <vector>
+#include <cstring>
+#include "HexitecProcessingTask.h"
+
+using namespace lima;
+using namespace lima::Hexitec;
+
+//-----------------------------------------------------
+// @brief ProcessingTask constructor
+//-----------------------------------------------------
+ProcessingTask::ProcessingTask(Camera::ProcessType processType, int kernel, int eventThreshold, int maxEnergy) :
+		LinkTask(true), m_processType(processType), m_kernel(kernel), m_eventThreshold(eventThreshold),
+		m_maxEnergy(maxEnergy), m_sortRow(selectSortRow()) {
+	DEB_CONSTRUCTOR();
+	DEB_TRACE() << "sort kernel " << sortRowName(m_sortRow);
+}
+
+//-----------------------------------------------------
+// @brief ProcessingTask destructor
+//-----------------------------------------------------
+ProcessingTask::~ProcessingTask() {
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief process one frame, called from the processlib pool threads
+//-----------------------------------------------------
+Data ProcessingTask::process(Data& srcData) {
+	switch (m_processType) {
+	case Camera::SORT:
+		return sort(srcData);
+	case Camera::CSA:
+		return chargeSharingAddition(srcData);
+	default:
+		return srcData;
+	}
+}
+
+//-----------------------------------------------------
+// @brief de-interleave the columns of a 16 bit frame
+//-----------------------------------------------------
+Data ProcessingTask::sort(Data& srcData) {
+	DEB_MEMBER_FUNCT();
+	int width = srcData.dimensions[0];
+	int height = srcData.dimensions[1];
+
+	if ((srcData.type != Data::UINT16 && srcData.type != Data::INT16) || (width % 4) != 0) {
+		DEB_ERROR() << "cannot sort " << DEB_VAR2(srcData.type, width);
+		return srcData;
+	}
+
+	Data dstData = srcData;
+	uint16_t* sptr = (uint16_t*) srcData.data();
+	if (_processingInPlaceFlag) {
+		// the kernel needs distinct rows, go through a copy of each
+		static thread_local std::vector<uint16_t> row;
+		row.resize(width);
+		for (int i = 0; i < height; i++, sptr += width) {
+			memcpy(row.data(), sptr, width * sizeof(uint16_t));
+			m_sortRow(row.data(), sptr, width);
+		}
+	} else {
+		Buffer* newBuffer = new Buffer(srcData.size());
+		dstData.setBuffer(newBuffer);
+		newBuffer->unref();
+		sortFrame(m_sortRow, sptr, (uint16_t*) dstData.data(), width, height);
+	}
+	return dstData;
+}
+
+//-----------------------------------------------------
+// @brief sort, then sum the clusters of hits into their largest pixel
+//-----------------------------------------------------
+Data ProcessingTask::chargeSharingAddition(Data& srcData) {
+	// one engine per pool thread, its scratch vectors are reused from frame to frame
+	static thread_local ChargeSharing chargeSharing;
+	int width = srcData.dimensions[0];
+
+	// frames that cannot be sorted are passed on untouched
+	if ((srcData.type != Data::UINT16 && srcData.type != Data::INT16) || (width % 4) != 0) {
+		return sort(srcData);
+	}
+	Data dstData = sort(srcData);
+	chargeSharing.add((uint16_t*) dstData.data(), dstData.dimensions[0], dstData.dimensions[1],
+			m_kernel, m_eventThreshold, m_maxEnergy);
+	return dstData;
+}
@@ -0,0 +1,85 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "HexitecReconstructionCtrlObj.h"
+#include "HexitecProcessingTask.h"
+#include "HexitecCamera.h"
+
+using namespace lima;
+using namespace lima::Hexitec;
+
+//-----------------------------------------------------
+// @brief ReconstructionCtrlObj constructor
+//-----------------------------------------------------
+ReconstructionCtrlObj::ReconstructionCtrlObj(Camera& cam) :
+		HwReconstructionCtrlObj(), m_cam(cam), m_task(NULL) {
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief ReconstructionCtrlObj destructor
+//-----------------------------------------------------
+ReconstructionCtrlObj::~ReconstructionCtrlObj() {
+	DEB_DESTRUCTOR();
+	if (m_task) {
+		m_task->unref();
+	}
+}
+
+//-----------------------------------------------------
+// @brief return the processing task, NULL for raw frames
+//-----------------------------------------------------
+LinkTask* ReconstructionCtrlObj::getReconstructionTask() {
+	return m_task;
+}
+
+//-----------------------------------------------------
+// @brief follow the process type selected on the camera
+//
+// The task is replaced rather than changed, frames of the previous
+// acquisition may still be in the pool threads holding a reference.
+//-----------------------------------------------------
+void ReconstructionCtrlObj::prepareAcq() {
+	DEB_MEMBER_FUNCT();
+	Camera::ProcessType type;
+	int kernel, eventThreshold, maxEnergy;
+
+	m_cam.getType(type);
+	m_cam.getChargeSharingKernel(kernel);
+	m_cam.getEventThreshold(eventThreshold);
+	m_cam.getEventMaxEnergy(maxEnergy);
+	if (type != Camera::SORT && type != Camera::CSA) {
+		type = Camera::RAW;
+	}
+	if (!m_task && type == Camera::RAW) {
+		return;
+	}
+	DEB_TRACE() << "processing " << DEB_VAR4(type, kernel, eventThreshold, maxEnergy);
+	if (m_task) {
+		m_task->unref();
+		m_task = NULL;
+	}
+	if (type != Camera::RAW) {
+		m_task = new ProcessingTask(type, kernel, eventThreshold, maxEnergy);
+	}
+	reconstructionChange(m_task);
+}
@@ -118,6 +118,56 @@ class Hexitec(PyTango.Device_4Impl):
         returnList.append(ov.ntcTemperature)
         attr.set_value(returnList)
 
+    @Core.DEB_MEMBER_FUNCT
+    def read_streamStatistics(self, attr):
+        returnList = []
+        st = _HexitecCamera.getStreamStatistics()
+        returnList.append(st.bandwidth)
+        returnList.append(st.acquisitionRate)
+        returnList.append(st.frameRate)
+        returnList.append(st.blockCount)
+        returnList.append(st.blocksDropped)
+        returnList.append(st.blockIdsMissing)
+        returnList.append(st.resendGroupRequested)
+        returnList.append(st.resendPacketRequested)
+        returnList.append(st.pipelineQueueDepth)
+        attr.set_value(returnList)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_statisticsInterval(self, attr):
+        attr.set_value(_HexitecCamera.getStatisticsInterval())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_statisticsInterval(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setStatisticsInterval(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_bufferMemoryBudget(self, attr):
+        attr.set_value(_HexitecCamera.getBufferMemoryBudget())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_bufferMemoryBudget(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setBufferMemoryBudget(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_stallTolerance(self, attr):
+        attr.set_value(_HexitecCamera.getStallTolerance())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_stallTolerance(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setStallTolerance(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_pipelineBufferCount(self, attr):
+        attr.set_value(_HexitecCamera.getPipelineBufferCount())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_limaBufferCount(self, attr):
+        attr.set_value(_HexitecCamera.getLimaBufferCount())
+
     @Core.DEB_MEMBER_FUNCT
     def read_collectDcTimeout(self, attr):
         attr.set_value(_HexitecCamera.getCollectDcTimeout())
@@ -183,6 +233,33 @@ class Hexitec(PyTango.Device_4Impl):
         data = attr.get_write_value()
         _HexitecCamera.setHighThreshold(data)
 
+    @Core.DEB_MEMBER_FUNCT
+    def read_eventThreshold(self, attr):
+        attr.set_value(_HexitecCamera.getEventThreshold())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_eventThreshold(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setEventThreshold(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_eventMaxEnergy(self, attr):
+        attr.set_value(_HexitecCamera.getEventMaxEnergy())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_eventMaxEnergy(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setEventMaxEnergy(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_chargeSharingKernel(self, attr):
+        attr.set_value(_HexitecCamera.getChargeSharingKernel())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_chargeSharingKernel(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setChargeSharingKernel(data)
+
     @Core.DEB_MEMBER_FUNCT
     def read_frameRate(self, attr):
         attr.set_value(_HexitecCamera.getFrameRate())
@@ -253,6 +330,179 @@ class Hexitec(PyTango.Device_4Impl):
     @Core.DEB_MEMBER_FUNCT
     def read_skippedFrameCount(self, attr):
         attr.set_value(_HexitecCamera.getSkippedFrameCount())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_missingFrameCount(self, attr):
+        attr.set_value(_HexitecCamera.getMissingFrameCount())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_discardedFrameCount(self, attr):
+        attr.set_value(_HexitecCamera.getDiscardedFrameCount())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_biasRefreshWindows(self, attr):
+        returnList = []
+        for i in range(_HexitecCamera.getBiasRefreshCount()):
+            window = _HexitecCamera.getBiasRefreshWindow(i)
+            returnList.append(window.startFrame)
+            returnList.append(window.endFrame)
+            returnList.append(window.imageNumber)
+        attr.set_value(returnList)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_zeroCopy(self, attr):
+        attr.set_value(_HexitecCamera.getZeroCopy())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_zeroCopy(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setZeroCopy(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_transferBufferFrameCount(self, attr):
+        attr.set_value(_HexitecCamera.getTransferBufferFrameCount())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_transferBufferFrameCount(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setTransferBufferFrameCount(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_acqThreadCpus(self, attr):
+        attr.set_value(_HexitecCamera.getAcqThreadCpus())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_acqThreadCpus(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setAcqThreadCpus(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_acqThreadPriority(self, attr):
+        attr.set_value(_HexitecCamera.getAcqThreadPriority())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_acqThreadPriority(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setAcqThreadPriority(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_bufferHandlingThreadCpus(self, attr):
+        attr.set_value(_HexitecCamera.getBufferHandlingThreadCpus())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_bufferHandlingThreadCpus(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setBufferHandlingThreadCpus(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_bufferHandlingThreadPriority(self, attr):
+        attr.set_value(_HexitecCamera.getBufferHandlingThreadPriority())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_bufferHandlingThreadPriority(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setBufferHandlingThreadPriority(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_hugePages(self, attr):
+        attr.set_value(_HexitecCamera.getHugePages())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_hugePages(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setHugePages(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_lockBuffers(self, attr):
+        attr.set_value(_HexitecCamera.getLockBuffers())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_lockBuffers(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setLockBuffers(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_numaBinding(self, attr):
+        attr.set_value(_HexitecCamera.getNumaBinding())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_numaBinding(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setNumaBinding(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_bufferAllocation(self, attr):
+        attr.set_value(_HexitecCamera.getBufferAllocation())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_preArm(self, attr):
+        attr.set_value(_HexitecCamera.getPreArm())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_preArm(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setPreArm(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_startLatency(self, attr):
+        attr.set_value(_HexitecCamera.getStartLatency())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_biasSettleTolerance(self, attr):
+        attr.set_value(_HexitecCamera.getBiasSettleTolerance())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_biasSettleTolerance(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setBiasSettleTolerance(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_biasSettleTime(self, attr):
+        attr.set_value(_HexitecCamera.getBiasSettleTime())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_registerCoherenceCheck(self, attr):
+        attr.set_value(_HexitecCamera.getRegisterCoherenceCheck())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_registerCoherenceCheck(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setRegisterCoherenceCheck(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_telemetryInterval(self, attr):
+        attr.set_value(_HexitecCamera.getTelemetryInterval())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_telemetryInterval(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setTelemetryInterval(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_telemetryFile(self, attr):
+        attr.set_value(_HexitecCamera.getTelemetryFile())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_telemetryFile(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setTelemetryFile(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_telemetryDeadline(self, attr):
+        attr.set_value(_HexitecCamera.getTelemetryDeadline())
+
+    @Core.DEB_MEMBER_FUNCT
+    def write_telemetryDeadline(self, attr):
+        data = attr.get_write_value()
+        _HexitecCamera.setTelemetryDeadline(data)
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_serialStatistics(self, attr):
+        attr.set_value(_HexitecCamera.getSerialStatistics())
+
+    @Core.DEB_MEMBER_FUNCT
+    def read_initialiseReport(self, attr):
+        attr.set_value(_HexitecCamera.getInitialiseReport())
         
 # ==================================================================
 #
@@ -263,6 +513,10 @@ class Hexitec(PyTango.Device_4Impl):
     def CollectOffsetValues(self):
         _HexitecCamera.collectOffsetValues()
 
+    @Core.DEB_MEMBER_FUNCT
+    def ResyncRegisters(self):
+        _HexitecCamera.resyncRegisters()
+
     @Core.DEB_MEMBER_FUNCT
     def HvBiasOn(self):
         _HexitecCamera.setHvBiasOn()
@@ -271,6 +525,24 @@ class Hexitec(PyTango.Device_4Impl):
     def HvBiasOff(self):
         _HexitecCamera.setBiasOff()
 
+    @Core.DEB_MEMBER_FUNCT
+    def ResetSerialStatistics(self):
+        _HexitecCamera.resetSerialStatistics()
+
+    @Core.DEB_MEMBER_FUNCT
+    def GetTelemetryHistory(self, seconds):
+        # 19 values per sample: timestamp, the 5 environment and the 13 operating values
+        returnList = []
+        for sample in _HexitecCamera.getTelemetryHistory(seconds):
+            ev = sample.env
+            ov = sample.opval
+            returnList += [sample.timestamp,
+                           ev.humidity, ev.ambientTemperature, ev.asicTemperature, ev.adcTemperature,
+                           ev.ntcTemperature,
+                           ov.v3_3, ov.hvMon, ov.hvOut, ov.v1_2, ov.v1_8, ov.v3, ov.v2_5, ov.v3_3ln,
+                           ov.v1_65ln, ov.v1_8ana, ov.v3_8ana, ov.peltierCurrent, ov.ntcTemperature]
+        return returnList
+
 
 # ==================================================================
 #
@@ -300,6 +572,9 @@ class HexitecClass(PyTango.DeviceClass):
         'asicPitch':
             [PyTango.DevLong,
              "Hexitec asic pitch", []],
+        'configStateFile':
+            [PyTango.DevString,
+             "File recording the configuration applied to the detector, empty always configures", [""]],
         }
 
     #    Command definitions
@@ -310,12 +585,21 @@ class HexitecClass(PyTango.DeviceClass):
         'CollectOffsetValues':
             [[PyTango.DevVoid, "none"],
              [PyTango.DevVoid, "none"]],
+        'ResyncRegisters':
+            [[PyTango.DevVoid, "none"],
+             [PyTango.DevVoid, "none"]],
         'HvBiasOn':
             [[PyTango.DevVoid, "none"],
              [PyTango.DevVoid, "none"]],
         'HvBiasOff':
             [[PyTango.DevVoid, "none"],
              [PyTango.DevVoid, "none"]],
+        'ResetSerialStatistics':
+            [[PyTango.DevVoid, "none"],
+             [PyTango.DevVoid, "none"]],
+        'GetTelemetryHistory':
+            [[PyTango.DevDouble, "Seconds of history"],
+             [PyTango.DevVarDoubleArray, "19 values per sample, oldest first"]],
         }
 
     #    Attribute definitions
@@ -328,6 +612,30 @@ class HexitecClass(PyTango.DeviceClass):
             [[PyTango.DevDouble,
               PyTango.SPECTRUM,
               PyTango.READ_WRITE, 13]],
+        'streamStatistics':
+            [[PyTango.DevDouble,
+              PyTango.SPECTRUM,
+              PyTango.READ, 9]],
+        'statisticsInterval':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'bufferMemoryBudget':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'stallTolerance':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'pipelineBufferCount':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'limaBufferCount':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ]],
         'collectDcTimeout':
             [[PyTango.DevLong,
               PyTango.SCALAR,
@@ -356,6 +664,18 @@ class HexitecClass(PyTango.DeviceClass):
             [[PyTango.DevLong,
               PyTango.SCALAR,
               PyTango.READ_WRITE]],
+        'eventThreshold':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'eventMaxEnergy':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'chargeSharingKernel':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
         'frameRate':
             [[PyTango.DevDouble,
               PyTango.SCALAR,
@@ -392,6 +712,98 @@ class HexitecClass(PyTango.DeviceClass):
             [[PyTango.DevLong,
               PyTango.SCALAR,
               PyTango.READ]],
+        'missingFrameCount':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'discardedFrameCount':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'biasRefreshWindows':
+            [[PyTango.DevLong,
+              PyTango.SPECTRUM,
+              PyTango.READ, 30000]],
+        'zeroCopy':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'transferBufferFrameCount':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'acqThreadCpus':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'acqThreadPriority':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'bufferHandlingThreadCpus':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'bufferHandlingThreadPriority':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'hugePages':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'lockBuffers':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'numaBinding':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'bufferAllocation':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'preArm':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'startLatency':
+            [[PyTango.DevDouble,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'biasSettleTolerance':
+            [[PyTango.DevDouble,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'biasSettleTime':
+            [[PyTango.DevDouble,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'registerCoherenceCheck':
+            [[PyTango.DevBoolean,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'telemetryDeadline':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'serialStatistics':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'initialiseReport':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ]],
+        'telemetryInterval':
+            [[PyTango.DevLong,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
+        'telemetryFile':
+            [[PyTango.DevString,
+              PyTango.SCALAR,
+              PyTango.READ_WRITE]],
         }
 
     def __init__(self, name):
@@ -403,7 +815,7 @@ _HexitecInterface = None
 _HexitecCamera = None
 
 
-def get_control(IPaddress="0", configFilename="0", bufferCount=50, timeout=600, asicPitch=250, **keys):
+def get_control(IPaddress="0", configFilename="0", bufferCount=50, timeout=600, asicPitch=250, configStateFile="", **keys):
     global _HexitecInterface
     global _HexitecCamera
 #    Core.DebParams.setTypeFlags(Core.DebParams.AllFlags)
@@ -411,7 +823,7 @@ def get_control(IPaddress="0", configFilename="0", bufferCount=50, timeout=600,
         print ("IPaddress ", IPaddress)
         print ("full path config file ", configFilename)
         _HexitecCamera = HexitecAcq.Camera(IPaddress, configFilename, int(bufferCount),
-                                           int(timeout), int(asicPitch))
+                                           int(timeout), int(asicPitch), configStateFile)
         _HexitecInterface = HexitecAcq.Interface(_HexitecCamera)
     ct = Core.CtControl(_HexitecInterface)
     print ("Core.Control done")
@@ -0,0 +1,208 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+// Charge sharing addition: the sparse engine against a dense flood fill reference,
+// and its cost against the dense per pixel window scan of test6 as occupancy grows
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <HexitecChargeSharing.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+using namespace lima::Hexitec;
+
+// flood fill over the kernel neighbourhood, same rules as ChargeSharing::add
+static void reference(std::vector<uint16_t>& frame, int width, int height, int kernel, int eventThresh, int emax) {
+	int radius = kernel / 2;
+	std::vector<int> label(frame.size(), -1);
+	std::vector<uint16_t> input = frame;
+
+	for (auto start = 0; start < width * height; start++) {
+		if (input[start] <= eventThresh || label[start] >= 0) {
+			continue;
+		}
+		std::vector<int> members = {start};
+		label[start] = start;
+		for (size_t m = 0; m < members.size(); m++) {
+			int y = members[m] / width;
+			int x = members[m] % width;
+			for (auto i = std::max(0, y - radius); i <= std::min(height - 1, y + radius); i++) {
+				for (auto j = std::max(0, x - radius); j <= std::min(width - 1, x + radius); j++) {
+					int p = i * width + j;
+					if (input[p] > eventThresh && label[p] < 0) {
+						label[p] = start;
+						members.push_back(p);
+					}
+				}
+			}
+		}
+		uint32_t sum = 0;
+		int max = members[0];
+		for (auto p : members) {
+			sum += input[p];
+			max = (input[p] > input[max]) ? p : max;
+		}
+		if (members.size() > 1 && sum < (uint32_t) emax) {
+			for (auto p : members) {
+				frame[p] = 0;
+			}
+			frame[max] = (uint16_t) std::min<uint32_t>(sum, 0xffff);
+		}
+	}
+}
+
+// the test6 prototype, rescans and rewrites a window around every hit
+static void denseWindow(uint16_t* dptr, int width, int height, int yp, int xp, int kernel, int eventThresh, int emax) {
+	int sumE = 0, maxE = 0, count = 0, maxX = 0, maxY = 0;
+	int starty = (yp < 0) ? 0 : yp;
+	int startx = (xp < 0) ? 0 : xp;
+	int endy = (yp + kernel < height) ? yp + kernel : height;
+	int endx = (xp + kernel < width) ? xp + kernel : width;
+	for (auto i = starty; i < endy; i++) {
+		for (auto j = startx; j < endx; j++) {
+			if (dptr[width * i + j] > eventThresh) {
+				sumE += dptr[width * i + j];
+				count++;
+				if (dptr[width * i + j] > maxE) {
+					maxE = dptr[width * i + j];
+					maxX = j;
+					maxY = i;
+				}
+			}
+		}
+	}
+	if (count > 1 && sumE < emax) {
+		for (auto i = starty; i < endy; i++) {
+			for (auto j = startx; j < endx; j++) {
+				dptr[width * i + j] = 0;
+			}
+		}
+		dptr[width * maxY + maxX] = sumE;
+	}
+}
+
+static void dense(uint16_t* frame, int width, int height, int kernel, int eventThresh, int emax) {
+	uint16_t* dptr = frame;
+	for (auto i = 0; i < height; i++) {
+		for (auto j = 0; j < width; j++, dptr++) {
+			if (*dptr > eventThresh) {
+				denseWindow(frame, width, height, i - kernel / 2, j - kernel / 2, kernel, eventThresh, emax);
+			}
+		}
+	}
+}
+
+// noise below the threshold plus photons sharing their charge with a random neighbour
+static std::vector<uint16_t> makeFrame(std::mt19937& rng, int width, int height, double occupancy) {
+	std::vector<uint16_t> frame(width * height);
+	std::uniform_int_distribution<int> noise(0, 8);
+	std::uniform_int_distribution<int> energy(100, 2000);
+	std::uniform_int_distribution<int> pixel(0, width * height - 1);
+	std::uniform_int_distribution<int> step(-1, 1);
+
+	for (auto& value : frame) {
+		value = noise(rng);
+	}
+	for (auto n = 0; n < (int) (occupancy * width * height / 2); n++) {
+		int p = pixel(rng);
+		int y = std::min(height - 1, std::max(0, p / width + step(rng)));
+		int x = std::min(width - 1, std::max(0, p % width + step(rng)));
+		int e = energy(rng);
+		frame[p] = e * 2 / 3;
+		frame[y * width + x] = e / 3;
+	}
+	return frame;
+}
+
+int main() {
+	const int eventThresh = 10;
+	const int emax = 4000;
+	std::mt19937 rng(1);
+	ChargeSharing csa;
+	bool ok = true;
+
+	for (auto kernel : {3, 5}) {
+		for (auto occupancy : {0.01, 0.05, 0.2, 0.6}) {
+			for (auto size : {7, 80, 123}) {
+				std::vector<uint16_t> frame = makeFrame(rng, size, size + 3, occupancy);
+				std::vector<uint16_t> expected = frame;
+				reference(expected, size, size + 3, kernel, eventThresh, emax);
+				csa.add(frame.data(), size, size + 3, kernel, eventThresh, emax);
+				if (frame != expected) {
+					std::cout << "mismatch " << kernel << "x" << kernel << " occupancy " << occupancy << " size " << size << std::endl;
+					ok = false;
+				}
+			}
+		}
+	}
+
+	// best of a few runs, the low occupancy 80x80 frames must not be slower than the dense scan
+	for (auto size : {80, 400}) {
+		for (auto kernel : {3, 5}) {
+			for (auto occupancy : {0.01, 0.05, 0.2}) {
+				std::vector<uint16_t> source = makeFrame(rng, size, size, occupancy);
+				std::vector<uint16_t> frame;
+				int frames = 4000000 / (size * size) + 1;
+				double sparse = 0., full = 0.;
+
+				for (auto run = 0; run < 5; run++) {
+					auto start = Clock::now();
+					for (auto n = 0; n < frames; n++) {
+						frame = source;
+						csa.add(frame.data(), size, size, kernel, eventThresh, emax);
+					}
+					std::chrono::duration<double, std::micro> add = Clock::now() - start;
+					start = Clock::now();
+					for (auto n = 0; n < frames; n++) {
+						frame = source;
+					}
+					std::chrono::duration<double, std::micro> copy = Clock::now() - start;
+					start = Clock::now();
+					for (auto n = 0; n < frames; n++) {
+						frame = source;
+						dense(frame.data(), size, size, kernel, eventThresh, emax);
+					}
+					std::chrono::duration<double, std::micro> scan = Clock::now() - start;
+					sparse = run ? std::min(sparse, (add - copy).count() / frames) : (add - copy).count() / frames;
+					full = run ? std::min(full, (scan - copy).count() / frames) : (scan - copy).count() / frames;
+				}
+
+				std::cout << size << "x" << size << " " << kernel << "x" << kernel << " occupancy "
+						<< std::setw(4) << occupancy << std::fixed << std::setprecision(1)
+						<< "  sparse " << std::setw(8) << sparse << " us"
+						<< "  dense " << std::setw(8) << full << " us" << std::endl;
+				std::cout.unsetf(std::ios::fixed);
+				if (size == 80 && occupancy == 0.01 && sparse > full) {
+					std::cout << "sparse slower than dense " << kernel << "x" << kernel << " occupancy " << occupancy << " size " << size << std::endl;
+					ok = false;
+				}
+			}
+		}
+	}
+	std::cout << (ok ? "OK" : "FAILED") << std::endl;
+	return ok ? 0 : 1;
+}
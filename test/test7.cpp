@@ -0,0 +1,111 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+// Micro-benchmark of the serial protocol hex codec against the former stringstream version
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <HexCodec.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+using namespace HexitecAPI;
+
+static_assert(hexDigit(0x0a, 1) == '0' && hexDigit(0x0a, 0) == 'A', "hexDigit");
+static_assert(hexValue("0A01", 4) == 0x0a01, "hexValue");
+static_assert(hexFit(0x12345, 4) == 0x1234, "hexFit");
+
+void oldHexToString(uint32_t number, uint8_t digits, uint8_t* ptr) {
+	std::stringstream ss;
+	ss << std::hex << std::setfill('0') << std::setw(digits)<< std::uppercase << number;
+	std::string s = ss.str();
+	for (auto i=0; i<digits; i++)
+		*ptr++ = s[i];
+}
+
+void oldHexToStringLE(uint32_t number, uint8_t digits, uint8_t* ptr) {
+	std::stringstream ss;
+	ss << std::hex << std::setfill('0') << std::setw(digits)<< std::uppercase << number;
+	std::string s = ss.str();
+	for (auto i=0; i<digits; i+=2) {
+		*ptr++ = s[digits-i-2];
+		*ptr++ = s[digits-i-1];
+	}
+}
+
+uint32_t oldStringToHex(const uint8_t* source, uint8_t digits) {
+	std::stringstream ss, ss2;
+	uint32_t number;
+	ss << source;
+	ss2 << ss.str().substr(0,digits);
+	ss2 >> std::hex >> number;
+	return number;
+}
+
+int main() {
+	const uint32_t loops = 1000000;
+	uint8_t oldBuffer[9] = {0};
+	uint8_t newBuffer[9] = {0};
+	uint32_t sum = 0;
+	int errors = 0;
+
+	for (uint32_t n = 0; n < 0x20000; n += 7) {
+		oldHexToString(n, 4, oldBuffer);
+		encodeHex(n, 4, newBuffer);
+		if (std::string((char*)oldBuffer, 4) != std::string((char*)newBuffer, 4)) {
+			std::cout << "encode mismatch " << n << std::endl;
+			errors++;
+		}
+		if (oldStringToHex(oldBuffer, 4) != decodeHex(newBuffer, 4)) {
+			std::cout << "decode mismatch " << n << std::endl;
+			errors++;
+		}
+		oldHexToStringLE(n * 4099, 8, oldBuffer);
+		encodeHexLE(n * 4099, 8, newBuffer);
+		if (std::string((char*)oldBuffer, 8) != std::string((char*)newBuffer, 8)) {
+			std::cout << "encodeLE mismatch " << n << std::endl;
+			errors++;
+		}
+	}
+	std::cout << "Mismatches: " << errors << std::endl;
+
+	auto t1 = Clock::now();
+	for (uint32_t n = 0; n < loops; n++) {
+		oldHexToString(n & 0xffff, 4, oldBuffer);
+		sum += oldStringToHex(oldBuffer, 4);
+	}
+	auto t2 = Clock::now();
+	for (uint32_t n = 0; n < loops; n++) {
+		encodeHex(n & 0xffff, 4, newBuffer);
+		sum += decodeHex(newBuffer, 4);
+	}
+	auto t3 = Clock::now();
+	std::cout << "stringstream encode+decode: "
+			<< std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / loops << " ns" << std::endl;
+	std::cout << "table codec encode+decode:  "
+			<< std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t2).count() / loops << " ns" << std::endl;
+	std::cout << "(checksum " << sum << ")" << std::endl;
+	return errors ? 1 : 0;
+}
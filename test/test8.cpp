@@ -0,0 +1,144 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+// Runs the serial command path of HexitecApi against the simulated detector and times it.
+// Usage: test8 [HexitecApi.ini]
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <map>
+#include <HexitecApi.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+using namespace HexitecAPI;
+
+static int errors = 0;
+
+static void check(const std::string& what, int32_t rc) {
+	if (rc != NO_ERROR) {
+		std::cout << what << " failed " << std::hex << rc << std::dec << std::endl;
+		errors++;
+	}
+}
+
+static double millis(Clock::time_point t1, Clock::time_point t2) {
+	return std::chrono::duration<double, std::milli>(t2 - t1).count();
+}
+
+int main(int argc, char *argv[]) {
+	HexitecApi hexitec("simulator", 1000);
+	uint32_t errorCode;
+	std::string errorCodeString;
+	std::string errorDescription;
+	const int loops = 20;
+
+	if (argc > 1) {
+		check("readConfiguration", hexitec.readConfiguration(argv[1]));
+	}
+	hexitec.initDevice(errorCode, errorCodeString, errorDescription);
+	check("initDevice", errorCode);
+	check("openSerialPort", hexitec.openSerialPortBulk0((2 << 16), true, 0x0d));
+
+	uint8_t customerId, projectId, version;
+	check("checkFirmware", hexitec.checkFirmware(customerId, projectId, version, false));
+	if (customerId != 0x01 || projectId != 0x02 || version != 0x03) {
+		std::cout << "unexpected firmware ids" << std::endl;
+		errors++;
+	}
+
+	uint8_t width, height;
+	double frameTime;
+	uint32_t collectDcTime;
+	auto t1 = Clock::now();
+	check("configureDetector", hexitec.configureDetector(width, height, frameTime, collectDcTime));
+	auto t2 = Clock::now();
+	if (width != 80 || height != 80) {
+		std::cout << "unexpected resolution " << int(width) << "x" << int(height) << std::endl;
+		errors++;
+	}
+	std::cout << "configureDetector: " << millis(t1, t2) << " ms" << std::endl;
+
+	bool configured = false;
+	t1 = Clock::now();
+	check("verifyConfiguration", hexitec.verifyConfiguration(configured));
+	check("resumeConfiguration", hexitec.resumeConfiguration(width, height, frameTime, collectDcTime));
+	t2 = Clock::now();
+	if (!configured || width != 80 || height != 80) {
+		std::cout << "configuration not recognised after configureDetector" << std::endl;
+		errors++;
+	}
+	std::cout << "verifyConfiguration + resumeConfiguration: " << millis(t1, t2) << " ms" << std::endl;
+
+	HexitecOperationMode mode;
+	t1 = Clock::now();
+	check("getOperationMode", hexitec.getOperationMode(mode));
+	t2 = Clock::now();
+	std::cout << "getOperationMode (shadowed): " << millis(t1, t2) << " ms" << std::endl;
+
+	double humidity, ambient, asic, adc, ntc;
+	t1 = Clock::now();
+	for (auto i = 0; i < loops; i++) {
+		check("readEnvironmentValues", hexitec.readEnvironmentValues(humidity, ambient, asic, adc, ntc));
+	}
+	t2 = Clock::now();
+	std::cout << "readEnvironmentValues: " << millis(t1, t2) / loops << " ms, ambient " << ambient << " C, ntc " << ntc << " C"
+			<< std::endl;
+
+	double v3_3, hvMon, hvOut, v1_2, v1_8, v3, v2_5, v3_3ln, v1_65ln, v1_8ana, v3_8ana, peltierCurrent;
+	t1 = Clock::now();
+	for (auto i = 0; i < loops; i++) {
+		check("readOperatingValues", hexitec.readOperatingValues(v3_3, hvMon, hvOut, v1_2, v1_8, v3, v2_5, v3_3ln, v1_65ln,
+				v1_8ana, v3_8ana, peltierCurrent, ntc));
+	}
+	t2 = Clock::now();
+	std::cout << "readOperatingValues: " << millis(t1, t2) / loops << " ms, peltier " << peltierCurrent << " A" << std::endl;
+
+	t1 = Clock::now();
+	check("setHvBiasOn", hexitec.setHvBiasOn(true));
+	t2 = Clock::now();
+	std::cout << "setHvBiasOn: " << millis(t1, t2) << " ms" << std::endl;
+
+	t1 = Clock::now();
+	check("enableTriggerGate", hexitec.enableTriggerGate());
+	check("disableTriggerGate", hexitec.disableTriggerGate());
+	t2 = Clock::now();
+	std::cout << "trigger gate on/off: " << millis(t1, t2) << " ms" << std::endl;
+
+	std::map<uint8_t, SerialStatistics> statistics;
+	hexitec.getSerialStatistics(statistics);
+	std::cout << "code count errors  wire p50 us  wire max us" << std::endl;
+	for (auto& entry : statistics) {
+		std::cout << "0x" << std::hex << int(entry.first) << std::dec << "  " << entry.second.count << "  "
+				<< entry.second.errors << "  " << entry.second.wireTime.percentile(0.5) << "  "
+				<< entry.second.wireTime.max() << std::endl;
+	}
+	if (statistics[0x52].count != loops || statistics[0x50].count != loops) {
+		std::cout << "unexpected serial statistics" << std::endl;
+		errors++;
+	}
+
+	hexitec.closeSerialPort();
+	std::cout << "Errors: " << errors << std::endl;
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2016
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+// Correctness check and micro-benchmark of the SORT de-interleave kernels, header only
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <HexitecSortKernel.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+using namespace lima::Hexitec;
+
+// readout position 4*k+b holds column b*(width/4)+k
+static bool check(SortRowFunction sortRow, int width, int height) {
+	int quarter = width / 4;
+	std::vector<uint16_t> src(width * height);
+	std::vector<uint16_t> dst(width * height, 0xffff);
+
+	for (auto i = 0; i < height; i++) {
+		for (auto p = 0; p < width; p++) {
+			src[i * width + p] = (uint16_t) (i * width + (p % 4) * quarter + p / 4);
+		}
+	}
+	sortFrame(sortRow, src.data(), dst.data(), width, height);
+	for (auto i = 0; i < width * height; i++) {
+		if (dst[i] != (uint16_t) i) {
+			std::cout << sortRowName(sortRow) << " width " << width << " wrong at " << i << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static double benchmark(SortRowFunction sortRow, int width, int height, int frames) {
+	std::vector<uint16_t> src(width * height);
+	std::vector<uint16_t> dst(width * height);
+
+	for (auto& value : src) {
+		value = rand() & 0x3fff;
+	}
+	auto start = Clock::now();
+	for (auto n = 0; n < frames; n++) {
+		sortFrame(sortRow, src.data(), dst.data(), width, height);
+		src[n % src.size()] = dst[(n * 7) % dst.size()];
+	}
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+	return frames / elapsed.count();
+}
+
+int main() {
+	std::vector<SortRowFunction> kernels = {sortRowScalar};
+	bool ok = true;
+
+#ifdef HEXITEC_SORT_X86
+	kernels.push_back(sortRowSse2);
+	if (__builtin_cpu_supports("avx2")) {
+		kernels.push_back(sortRowAvx2);
+	}
+#endif
+	for (auto sortRow : kernels) {
+		for (auto width : {4, 32, 36, 64, 80, 100, 128, 400}) {
+			ok = check(sortRow, width, 3) && ok;
+		}
+	}
+	std::cout << "selected " << sortRowName(selectSortRow()) << std::endl;
+
+	// 80x80 runs at about 6.3 kHz, give the frame rate each kernel sustains on one core
+	for (auto width : {80, 400}) {
+		int height = width;
+		for (auto sortRow : kernels) {
+			double rate = benchmark(sortRow, width, height, 4000000 / width);
+			std::cout << std::setw(7) << sortRowName(sortRow) << " " << width << "x" << height << " "
+					<< std::fixed << std::setprecision(0) << rate << " frames/s" << std::endl;
+		}
+	}
+	std::cout << (ok ? "OK" : "FAILED") << std::endl;
+	return ok ? 0 : 1;
+}